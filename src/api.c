@@ -0,0 +1,331 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+
+#include "salt.h"
+
+/*
+
+  Versioned library interface
+
+  The functions below are the stable entry points of libsalt.so: a
+  context selects a kernel, a scoring scheme and a number of threads;
+  pairs of sequences are then aligned in batches, or one query (a
+  profile) against a batch of database sequences. Sequences are given as
+  nucleotide text and results as fixed-width integers, so that the
+  layout of the structures does not depend on the kernels or on the
+  internal representation of reads. Clients that dlopen the library
+  should compare salt_api_version() with SALT_API_VERSION and must not
+  use a library of another major version.
+
+  A batch is split over the threads of the context. Every thread encodes
+  the sequences of its pairs into an arena of its own, which is reset
+  after each pair, so a batch allocates nothing once the arenas have
+  grown to the longest pair. Pairs whose scores may not fit into the
+  bits of the kernel are aligned by the CPU kernel instead.
+
+  A profile holds the query profile of the kernel (the scores of the
+  four nucleotides against every query position, in the layout of the
+  kernel's vectors), which the column kernels otherwise build on every
+  call; it is built once and shared read-only by all threads. AUTO uses
+  the column kernel of the narrowest cells holding the scores of the
+  query for profiles, and the kernels without a query profile (CPU and
+  the diagonal kernels) align the pairs as in a batch.
+
+  The api functions return SALT_OK or a negative error code (NULL for
+  constructors) on invalid arguments, instead of terminating the
+  process; running out of memory is still fatal.
+
+*/
+
+struct salt_context_s
+{
+  const salt_kernel_t * kernel;
+  const salt_kernel_t * fallback;
+  salt_scoring_t * scoring;
+  salt_pool_t * pool;
+  long threads;
+  salt_arena_t ** arenas;
+};
+
+struct salt_profile_s
+{
+  BYTE * seq;
+  long len;
+
+  /* query profile of the kernel, for the scores of the context when the
+     profile was created; NULL if the kernel has none */
+  const salt_kernel_t * kernel;
+  void * prof;
+  long match;
+  long mismatch;
+};
+
+typedef struct
+{
+  salt_context_t * ctx;
+  const salt_pair_t * pairs;
+  const salt_profile_t * profile;
+  const char * const * dseqs;
+  const int64_t * dlens;
+  salt_result_t * results;
+} api_job_t;
+
+/* 2-bit encoded, zero padded and aligned copy of s */
+static BYTE * api_encode(salt_arena_t * a, const char * s, long len)
+{
+  long padded_len = roundup(len + 1, SALT_ALIGNMENT_MAX);
+  BYTE * e = (BYTE *) salt_arena_alloc(a, padded_len, SALT_ALIGNMENT_MAX);
+
+  for (long i = 0; i < len; ++i)
+    e[i] = chrmap_2bit[(unsigned char) s[i]];
+  memset(e + len, 0, (size_t)(padded_len - len));
+
+  return e;
+}
+
+static void api_result(const salt_overlap_t * ovl, salt_result_t * r)
+{
+  r->score = ovl->score;
+  r->len = ovl->len;
+  r->matches = ovl->matches;
+  r->dstart = ovl->dstart;
+  r->dend = ovl->dend;
+  r->qstart = ovl->qstart;
+  r->qend = ovl->qend;
+  r->matchcase = (int32_t) ovl->matchcase;
+  r->reserved = 0;
+}
+
+static void api_align(salt_context_t * ctx, BYTE * dseq, long dlen,
+                      BYTE * qseq, long qlen, salt_result_t * r)
+{
+  const salt_kernel_t * kernel = ctx->kernel;
+  salt_overlap_t ovl;
+
+  /* the largest absolute value of a cell is reached on the shorter read */
+  long cells = (dlen < qlen ? dlen : qlen) * ctx->scoring->maxabs;
+
+  if (kernel->bits < 64 && cells >= (1l << (kernel->bits - 1)))
+    kernel = ctx->fallback;
+
+  salt_overlap_pair(kernel, ctx->scoring, dseq, dlen, qseq, qlen, &ovl);
+  api_result(&ovl, r);
+}
+
+static void api_pairs_range(long begin, long end, long tid, void * data)
+{
+  api_job_t * job = (api_job_t *) data;
+  salt_arena_t * a = job->ctx->arenas[tid];
+
+  for (long i = begin; i < end; ++i)
+  {
+    const salt_pair_t * p = job->pairs + i;
+
+    salt_arena_reset(a);
+    BYTE * dseq = api_encode(a, p->dseq, p->dlen);
+    BYTE * qseq = api_encode(a, p->qseq, p->qlen);
+
+    api_align(job->ctx, dseq, p->dlen, qseq, p->qlen, job->results + i);
+  }
+}
+
+static void api_profile_range(long begin, long end, long tid, void * data)
+{
+  api_job_t * job = (api_job_t *) data;
+  salt_arena_t * a = job->ctx->arenas[tid];
+
+  const salt_profile_t * p = job->profile;
+
+  for (long i = begin; i < end; ++i)
+  {
+    salt_arena_reset(a);
+    BYTE * dseq = api_encode(a, job->dseqs[i], job->dlens[i]);
+
+    if (p->prof && salt_kernel_fits(p->kernel, job->ctx->scoring,
+                                    job->dlens[i], p->len))
+    {
+      salt_overlap_t ovl;
+      salt_overlap_pair_profile(p->kernel, p->prof, dseq, job->dlens[i],
+                                p->seq, p->len, &ovl);
+      api_result(&ovl, job->results + i);
+    }
+    else
+      api_align(job->ctx, dseq, job->dlens[i], p->seq, p->len,
+                job->results + i);
+  }
+}
+
+static void api_run(salt_context_t * ctx, long count,
+                    void (*fn)(long begin, long end, long tid, void * data),
+                    api_job_t * job)
+{
+  if (ctx->pool)
+    salt_pool_run(ctx->pool, count, 16, fn, job);
+  else
+    fn(0, count, 0, job);
+}
+
+/* version of the library, to be compared with SALT_API_VERSION */
+uint32_t salt_api_version(void)
+{
+  return SALT_API_VERSION;
+}
+
+/* version is the SALT_API_VERSION the caller was compiled with; kernel is
+   the name of a kernel (see --algorithm), or NULL for the adaptive kernel
+   (AUTO), which picks cells of 8, 16 or 32 bits for every pair. The
+   scoring scheme is +1/-1 until changed. */
+salt_context_t * salt_context_create(uint32_t version, const char * kernel,
+                                     int64_t threads)
+{
+  if ((version >> 16) != SALT_API_MAJOR || threads < 1)
+    return NULL;
+
+  const salt_kernel_t * k;
+  if (kernel)
+    k = salt_kernel_get(kernel);
+  else
+    k = salt_kernel_get("AUTO");
+
+  if (!k)
+    return NULL;
+
+  salt_context_t * ctx = (salt_context_t *) xmalloc(sizeof(salt_context_t),
+                                                    8);
+  ctx->kernel = k;
+  ctx->fallback = salt_kernel_get("CPU");
+  ctx->scoring = salt_scoring_create(1, -1);
+  ctx->threads = threads;
+  ctx->pool = (threads > 1) ? salt_pool_create(threads) : NULL;
+  ctx->arenas = (salt_arena_t **) xmalloc(threads * sizeof(salt_arena_t *),
+                                          8);
+  for (long i = 0; i < threads; ++i)
+    ctx->arenas[i] = salt_arena_create(1 << 16, salt_arena_default_flags());
+
+  return ctx;
+}
+
+void salt_context_destroy(salt_context_t * ctx)
+{
+  if (ctx->pool)
+    salt_pool_destroy(ctx->pool);
+  for (long i = 0; i < ctx->threads; ++i)
+    salt_arena_destroy(ctx->arenas[i]);
+  free(ctx->arenas);
+  salt_scoring_destroy(ctx->scoring);
+  free(ctx);
+}
+
+/* name of the kernel selected by the context */
+const char * salt_context_kernel(const salt_context_t * ctx)
+{
+  return ctx->kernel->name;
+}
+
+/* score of a match and of a mismatch */
+int salt_context_scoring(salt_context_t * ctx, int64_t match,
+                         int64_t mismatch)
+{
+  if (match > 127 || match < -128 || mismatch > 127 || mismatch < -128)
+    return SALT_ERR_ARG;
+
+  salt_scoring_destroy(ctx->scoring);
+  ctx->scoring = salt_scoring_create(match, mismatch);
+
+  return SALT_OK;
+}
+
+/* align the pairs[0..count-1] and store the results in results[] */
+int salt_align_batch(salt_context_t * ctx, const salt_pair_t * pairs,
+                     int64_t count, salt_result_t * results)
+{
+  if (count < 0 || (count && (!pairs || !results)))
+    return SALT_ERR_ARG;
+
+  for (long i = 0; i < count; ++i)
+    if (pairs[i].dlen < 1 || pairs[i].qlen < 1)
+      return SALT_ERR_ARG;
+
+  api_job_t job = { ctx, pairs, NULL, NULL, NULL, results };
+  api_run(ctx, count, api_pairs_range, &job);
+
+  return SALT_OK;
+}
+
+/* query to be aligned against many database sequences: the encoded
+   query and the query profile of the kernel of the context (see
+   salt_kernel_profiled), built once for the current scores */
+salt_profile_t * salt_profile_create(salt_context_t * ctx, const char * seq,
+                                     int64_t len)
+{
+  if (!seq || len < 1)
+    return NULL;
+
+  salt_profile_t * p = (salt_profile_t *) xmalloc(sizeof(salt_profile_t), 8);
+  long padded_len = roundup(len + 1, SALT_ALIGNMENT_MAX);
+
+  p->len = len;
+  p->seq = (BYTE *) xmalloc(padded_len, SALT_ALIGNMENT_MAX);
+  for (long i = 0; i < len; ++i)
+    p->seq[i] = chrmap_2bit[(unsigned char) seq[i]];
+  memset(p->seq + len, 0, (size_t)(padded_len - len));
+
+  p->match = ctx->scoring->match;
+  p->mismatch = ctx->scoring->mismatch;
+  p->kernel = salt_kernel_profiled(ctx->kernel, ctx->scoring, len);
+  p->prof = NULL;
+  if (p->kernel)
+    p->prof = p->kernel->profile(ctx->scoring, p->seq, p->seq + len);
+
+  return p;
+}
+
+void salt_profile_destroy(salt_profile_t * p)
+{
+  if (p->prof)
+    free(p->prof);
+  free(p->seq);
+  free(p);
+}
+
+/* align the query of the profile (as q) with dseqs[0..count-1] (as d);
+   the scores of the context must be the ones of the profile */
+int salt_align_profile(salt_context_t * ctx, const salt_profile_t * profile,
+                       const char * const * dseqs, const int64_t * dlens,
+                       int64_t count, salt_result_t * results)
+{
+  if (!profile || count < 0 || (count && (!dseqs || !dlens || !results)))
+    return SALT_ERR_ARG;
+
+  if (profile->match != ctx->scoring->match ||
+      profile->mismatch != ctx->scoring->mismatch)
+    return SALT_ERR_ARG;
+
+  for (long i = 0; i < count; ++i)
+    if (dlens[i] < 1)
+      return SALT_ERR_ARG;
+
+  api_job_t job = { ctx, NULL, profile, dseqs, dlens, results };
+  api_run(ctx, count, api_profile_range, &job);
+
+  return SALT_OK;
+}
@@ -0,0 +1,204 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+
+#define _GNU_SOURCE
+
+#include "salt.h"
+#include <sys/mman.h>
+
+/*
+
+  Aligned bump allocator
+
+  An arena hands out memory from large anonymous mappings by bumping an
+  offset, so an allocation costs an alignment and a compare, and nothing
+  is returned to the system until the arena is reset or destroyed.
+  salt_arena_reset releases all allocations at once; blocks that were
+  chained because the first one ran out are then merged into a single
+  block of the combined size, so a workload that repeats the same
+  allocations (one batch, one pair of sequences) settles on one block and
+  no further system calls.
+
+  With SALT_ARENA_HUGEPAGES the blocks are aligned to and sized in 2MB
+  and marked for transparent huge pages (the kernel may still decline).
+  With SALT_ARENA_PREFAULT every page of a new block is written once when
+  it is mapped, so the page faults are taken up front rather than spread
+  over the first pass of a large job.
+
+  Every thread also has a scratch arena (salt_kernel_scratch) for the
+  buffers of the overlap kernels only: each kernel call resets it, which
+  releases anything else allocated from it. It is created with the flags
+  given to salt_arena_defaults and unmapped when the thread exits.
+
+*/
+
+#define ARENA_PAGE     4096
+#define ARENA_HUGEPAGE (2l << 20)
+
+/* first block of a kernel scratch arena */
+#define SCRATCH_SIZE (256l << 10)
+
+static int arena_flags = 0;
+
+__thread salt_arena_t * salt_kernel_scratch_local = NULL;
+static pthread_once_t scratch_once = PTHREAD_ONCE_INIT;
+static pthread_key_t scratch_key;
+
+/* map a block with room for at least size bytes after its header */
+static salt_arena_block_t * arena_block_create(size_t size, int flags)
+{
+  size_t align = (flags & SALT_ARENA_HUGEPAGES) ? ARENA_HUGEPAGE : ARENA_PAGE;
+  size_t total = roundup(size + sizeof(salt_arena_block_t), align);
+  size_t extra = align - ARENA_PAGE;
+
+  char * p = (char *) mmap(NULL, total + extra, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED)
+    fatal("Unable to allocate enough memory.");
+
+  /* trim the mapping to an aligned block */
+  if (extra)
+  {
+    size_t head = roundup((long)p, align) - (long)p;
+    if (head)
+      munmap(p, head);
+    if (extra - head)
+      munmap(p + head + total, extra - head);
+    p += head;
+  }
+
+  if (flags & SALT_ARENA_HUGEPAGES)
+    madvise(p, total, MADV_HUGEPAGE);
+
+  if (flags & SALT_ARENA_PREFAULT)
+    for (size_t i = 0; i < total; i += ARENA_PAGE)
+      ((volatile char *) p)[i] = 0;
+
+  salt_arena_block_t * b = (salt_arena_block_t *) p;
+  b->next = NULL;
+  b->size = total;
+  b->used = sizeof(salt_arena_block_t);
+
+  return b;
+}
+
+/* flags are SALT_ARENA_HUGEPAGES and SALT_ARENA_PREFAULT; size is the
+   capacity of the first block, which is mapped right away */
+salt_arena_t * salt_arena_create(size_t size, int flags)
+{
+  salt_arena_t * a = (salt_arena_t *) xmalloc(sizeof(salt_arena_t), 8);
+
+  a->flags = flags;
+  a->head = arena_block_create(size, flags);
+  a->capacity = a->head->size;
+
+  return a;
+}
+
+/* slow path of salt_arena_alloc: chain a new block in front, growing
+   geometrically so that a reset merges few blocks */
+void * salt_arena_grow(salt_arena_t * a, size_t size, size_t alignment)
+{
+  size_t want = size + alignment;
+
+  if (want < a->capacity)
+    want = a->capacity;
+
+  salt_arena_block_t * b = arena_block_create(want, a->flags);
+  b->next = a->head;
+  a->head = b;
+  a->capacity += b->size;
+
+  size_t offset = roundup(b->used, alignment);
+  b->used = offset + size;
+
+  return (char *) b + offset;
+}
+
+/* slow path of salt_arena_reset: replace the chain of blocks by a single
+   block of the same capacity */
+void salt_arena_merge(salt_arena_t * a)
+{
+  salt_arena_block_t * b = a->head;
+
+  while (b)
+  {
+    salt_arena_block_t * next = b->next;
+    munmap(b, b->size);
+    b = next;
+  }
+
+  a->head = arena_block_create(a->capacity, a->flags);
+  a->capacity = a->head->size;
+}
+
+void salt_arena_destroy(salt_arena_t * a)
+{
+  salt_arena_block_t * b = a->head;
+
+  while (b)
+  {
+    salt_arena_block_t * next = b->next;
+    munmap(b, b->size);
+    b = next;
+  }
+
+  free(a);
+}
+
+/* bytes mapped by the arena */
+size_t salt_arena_capacity(salt_arena_t * a)
+{
+  return a->capacity;
+}
+
+/* flags of the arenas created for kernel scratch, read sets and writers */
+void salt_arena_defaults(int flags)
+{
+  arena_flags = flags;
+}
+
+int salt_arena_default_flags()
+{
+  return arena_flags;
+}
+
+static void scratch_exit(void * data)
+{
+  salt_arena_destroy((salt_arena_t *) data);
+}
+
+static void scratch_key_create()
+{
+  pthread_key_create(&scratch_key, scratch_exit);
+}
+
+/* first call of salt_kernel_scratch in a thread */
+salt_arena_t * salt_kernel_scratch_create()
+{
+  pthread_once(&scratch_once, scratch_key_create);
+
+  salt_kernel_scratch_local = salt_arena_create(SCRATCH_SIZE, arena_flags);
+  pthread_setspecific(scratch_key, salt_kernel_scratch_local);
+
+  return salt_kernel_scratch_local;
+}
@@ -0,0 +1,192 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+#include "salt.h"
+
+/*
+
+  Blocks of sequence records stored in a single aligned arena
+
+  Every sequence starts at an offset aligned to SALT_ALIGNMENT_MAX and is
+  followed by zeros up to the next multiple of SALT_ALIGNMENT_MAX (at least
+  one terminating zero), so that the kernels can run their aligned loads
+  over the padded tail without copying the sequence first. Headers are
+  stored back to back as zero-terminated strings. The record tables are
+  kept as separate arrays (offsets, lengths, sizes) and all memory is owned
+  by the batch and reused between fills.
+
+*/
+
+static long grow_size(long alloc, long needed)
+{
+  long size = alloc ? alloc : MEMCHUNK;
+
+  while (size < needed)
+    size <<= 1;
+
+  return size;
+}
+
+salt_batch_t * salt_batch_create(long max_records, long max_bytes)
+{
+  salt_batch_t * batch = (salt_batch_t *)xmalloc(sizeof(salt_batch_t), 8);
+
+  batch->max_records = max_records;
+  batch->max_bytes = max_bytes;
+
+  batch->arena_alloc = MEMCHUNK;
+  batch->arena = (char *)xmalloc((size_t)batch->arena_alloc, SALT_ALIGNMENT_MAX);
+
+  batch->qual = NULL;
+
+  batch->heads_alloc = MEMCHUNK;
+  batch->heads = (char *)xmalloc((size_t)batch->heads_alloc, 8);
+
+  batch->records_alloc = 0;
+  batch->seq_offset = NULL;
+  batch->seq_len = NULL;
+  batch->head_offset = NULL;
+  batch->head_len = NULL;
+  batch->qsize = NULL;
+
+  salt_batch_reset(batch);
+
+  return batch;
+}
+
+void salt_batch_reset(salt_batch_t * batch)
+{
+  batch->count = 0;
+  batch->first_qno = 0;
+  batch->arena_len = 0;
+  batch->heads_len = 0;
+}
+
+void salt_batch_destroy(salt_batch_t * batch)
+{
+  free(batch->arena);
+  if (batch->qual)
+    free(batch->qual);
+  free(batch->heads);
+
+  if (batch->seq_offset)
+  {
+    free(batch->seq_offset);
+    free(batch->seq_len);
+    free(batch->head_offset);
+    free(batch->head_len);
+    free(batch->qsize);
+  }
+
+  free(batch);
+}
+
+int salt_batch_full(salt_batch_t * batch)
+{
+  if (batch->max_records && batch->count >= batch->max_records)
+    return 1;
+
+  if (batch->max_bytes && batch->arena_len >= batch->max_bytes)
+    return 1;
+
+  return 0;
+}
+
+void salt_batch_append(salt_batch_t * batch,
+                       char * head, long head_len,
+                       char * seq, long seq_len,
+                       char * qual,
+                       long qsize)
+{
+  long offset = batch->arena_len;
+  long padded_len = roundup(seq_len+1, SALT_ALIGNMENT_MAX);
+
+  /* record tables */
+
+  if (batch->count == batch->records_alloc)
+  {
+    batch->records_alloc = batch->records_alloc ? 2*batch->records_alloc : 256;
+
+    size_t size = batch->records_alloc * sizeof(long);
+    batch->seq_offset  = (long *)xrealloc(batch->seq_offset, size);
+    batch->seq_len     = (long *)xrealloc(batch->seq_len, size);
+    batch->head_offset = (long *)xrealloc(batch->head_offset, size);
+    batch->head_len    = (long *)xrealloc(batch->head_len, size);
+    batch->qsize       = (long *)xrealloc(batch->qsize, size);
+  }
+
+  /* sequence (and quality) arena */
+
+  if (offset + padded_len > batch->arena_alloc)
+  {
+    long size = grow_size(batch->arena_alloc, offset + padded_len);
+
+    batch->arena = (char *)xrealloc_aligned(batch->arena, offset, size,
+                                            SALT_ALIGNMENT_MAX);
+    if (batch->qual)
+      batch->qual = (char *)xrealloc_aligned(batch->qual, offset, size,
+                                             SALT_ALIGNMENT_MAX);
+
+    batch->arena_alloc = size;
+  }
+
+  if (qual && !batch->qual)
+  {
+    batch->qual = (char *)xmalloc((size_t)batch->arena_alloc,
+                                  SALT_ALIGNMENT_MAX);
+    memset(batch->qual, 0, (size_t)offset);
+  }
+
+  memcpy(batch->arena + offset, seq, (size_t)seq_len);
+  memset(batch->arena + offset + seq_len, 0, (size_t)(padded_len - seq_len));
+
+  if (batch->qual)
+  {
+    if (qual)
+      memcpy(batch->qual + offset, qual, (size_t)seq_len);
+    else
+      memset(batch->qual + offset, 0, (size_t)seq_len);
+    memset(batch->qual + offset + seq_len, 0, (size_t)(padded_len - seq_len));
+  }
+
+  batch->arena_len += padded_len;
+
+  /* headers */
+
+  if (batch->heads_len + head_len + 1 > batch->heads_alloc)
+  {
+    batch->heads_alloc = grow_size(batch->heads_alloc,
+                                   batch->heads_len + head_len + 1);
+    batch->heads = (char *)xrealloc(batch->heads, (size_t)batch->heads_alloc);
+  }
+
+  memcpy(batch->heads + batch->heads_len, head, (size_t)head_len);
+  batch->heads[batch->heads_len + head_len] = 0;
+
+  batch->seq_offset[batch->count]  = offset;
+  batch->seq_len[batch->count]     = seq_len;
+  batch->head_offset[batch->count] = batch->heads_len;
+  batch->head_len[batch->count]    = head_len;
+  batch->qsize[batch->count]       = qsize;
+
+  batch->heads_len += head_len + 1;
+  batch->count++;
+}
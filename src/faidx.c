@@ -0,0 +1,346 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+#include "salt.h"
+
+/*
+
+  Fasta index compatible with samtools faidx
+
+  The index has one tab separated line per record:
+
+  NAME    name of the record, the header up to the first whitespace
+  LENGTH  number of bases
+  OFFSET  byte offset of the first base
+  LINEBASES  bases per line
+  LINEWIDTH  bytes per line, including the line terminator
+
+  All lines of a record except the last one must have the same length.
+  The index of file.fa is stored as file.fa.fai.
+
+*/
+
+static char * fai_filename(const char * filename)
+{
+  char * fai = (char *) xmalloc(strlen(filename) + 5, 8);
+
+  strcpy(fai, filename);
+  strcat(fai, ".fai");
+
+  return fai;
+}
+
+void salt_fai_build(const char * filename)
+{
+  char line[LINEALLOC];
+  char * fainame = fai_filename(filename);
+
+  FILE * fp = fopen(filename, "r");
+  if (!fp)
+    fatal("Error: Unable to open fasta file (%s)", filename);
+
+  FILE * out = fopen(fainame, "w");
+  if (!out)
+    fatal("Error: Unable to open fasta index for writing (%s)", fainame);
+
+  char * name = NULL;
+  long pos = 0;
+  long lineno = 0;
+  long len = 0, offset = 0, linebases = 0, linewidth = 0;
+  long lastbases = 0;
+  int ended = 0;
+
+  while (fgets(line, LINEALLOC, fp))
+  {
+    int header = (line[0] == '>');
+
+    lineno++;
+
+    if (header)
+    {
+      if (name)
+        fprintf(out, "%s\t%ld\t%ld\t%ld\t%ld\n",
+                name, len, offset, linebases, linewidth);
+      free(name);
+
+      long n = strcspn(line + 1, " \t\r\n");
+      name = (char *) xmalloc(n + 1, 8);
+      memcpy(name, line + 1, n);
+      name[n] = 0;
+    }
+
+    /* join the fragments of long lines, remembering the last two bytes */
+    long width = 0;
+    char c1 = 0;
+    char c2 = 0;
+    do
+    {
+      long n = strlen(line);
+      width += n;
+      c2 = (n > 1) ? line[n-2] : c1;
+      c1 = line[n-1];
+    }
+    while (c1 != '\n' && fgets(line, LINEALLOC, fp));
+
+    pos += width;
+
+    if (header)
+    {
+      len = 0;
+      offset = pos;
+      linebases = 0;
+      linewidth = 0;
+      lastbases = 0;
+      ended = 0;
+      continue;
+    }
+
+    if (!name)
+      fatal("Illegal header line in fasta file (%s)", filename);
+
+    long bases = width;
+    if (c1 == '\n')
+    {
+      bases--;
+      if (c2 == '\r')
+        bases--;
+    }
+
+    if (!bases)
+    {
+      /* an empty line ends the sequence of the record */
+      ended = 1;
+      continue;
+    }
+
+    if (!linebases)
+    {
+      linebases = bases;
+      linewidth = width;
+    }
+    else if (ended || lastbases != linebases || bases > linebases ||
+             (bases == linebases && width != linewidth))
+      fatal("Error: Different line lengths in record %s on line %ld, "
+            "cannot index (%s)", name, lineno, filename);
+
+    lastbases = bases;
+    len += bases;
+  }
+
+  if (name)
+    fprintf(out, "%s\t%ld\t%ld\t%ld\t%ld\n",
+            name, len, offset, linebases, linewidth);
+  free(name);
+
+  fclose(fp);
+  if (fclose(out))
+    fatal("Error: Unable to write fasta index (%s)", fainame);
+
+  free(fainame);
+}
+
+/* compares pointers to entries, so that no global state is needed and
+   indexes can be loaded by several threads at once */
+static int fai_compare(const void * a, const void * b)
+{
+  return strcmp((*(salt_fai_entry_t * const *)a)->name,
+                (*(salt_fai_entry_t * const *)b)->name);
+}
+
+salt_fai_t * salt_fai_load(const char * filename)
+{
+  char line[LINEALLOC];
+  char * fainame = fai_filename(filename);
+
+  FILE * in = fopen(fainame, "r");
+  if (!in)
+    fatal("Error: Unable to open fasta index (%s)", fainame);
+
+  salt_fai_t * fai = (salt_fai_t *) xmalloc(sizeof(salt_fai_t), 8);
+  long alloc = 0;
+
+  fai->count = 0;
+  fai->entries = NULL;
+
+  while (fgets(line, LINEALLOC, in))
+  {
+    char name[LINEALLOC];
+    salt_fai_entry_t e;
+
+    if (sscanf(line, "%s\t%ld\t%ld\t%ld\t%ld", name,
+               &e.len, &e.offset, &e.linebases, &e.linewidth) != 5)
+      fatal("Error: Illegal line %ld in fasta index (%s)",
+            fai->count + 1, fainame);
+
+    if (fai->count == alloc)
+    {
+      alloc = alloc ? 2*alloc : 1024;
+      fai->entries = (salt_fai_entry_t *) xrealloc(fai->entries,
+                                                   alloc * sizeof(salt_fai_entry_t));
+    }
+
+    e.name = (char *) xmalloc(strlen(name) + 1, 8);
+    strcpy(e.name, name);
+    fai->entries[fai->count++] = e;
+  }
+
+  fclose(in);
+  free(fainame);
+
+  /* ordinals sorted by name for lookups */
+  salt_fai_entry_t ** order =
+    (salt_fai_entry_t **) xmalloc((fai->count + 1) *
+                                  sizeof(salt_fai_entry_t *), 8);
+  for (long i = 0; i < fai->count; ++i)
+    order[i] = fai->entries + i;
+
+  qsort(order, fai->count, sizeof(salt_fai_entry_t *), fai_compare);
+
+  fai->sorted = (long *) xmalloc((fai->count + 1) * sizeof(long), 8);
+  for (long i = 0; i < fai->count; ++i)
+    fai->sorted[i] = order[i] - fai->entries;
+  free(order);
+
+  fai->fp = fopen(filename, "r");
+  if (!fai->fp)
+    fatal("Error: Unable to open fasta file (%s)", filename);
+
+  fai->buf_alloc = 0;
+  fai->buf = NULL;
+  fai->raw_alloc = 0;
+  fai->raw = NULL;
+
+  return fai;
+}
+
+void salt_fai_close(salt_fai_t * fai)
+{
+  fclose(fai->fp);
+
+  for (long i = 0; i < fai->count; ++i)
+    free(fai->entries[i].name);
+
+  free(fai->entries);
+  free(fai->sorted);
+  free(fai->buf);
+  free(fai->raw);
+  free(fai);
+}
+
+long salt_fai_count(salt_fai_t * fai)
+{
+  return fai->count;
+}
+
+const char * salt_fai_name(salt_fai_t * fai, long i)
+{
+  return fai->entries[i].name;
+}
+
+long salt_fai_length(salt_fai_t * fai, long i)
+{
+  return fai->entries[i].len;
+}
+
+/* return the ordinal of the record with the given name, -1 if not found */
+long salt_fai_lookup(salt_fai_t * fai, const char * name)
+{
+  long lo = 0;
+  long hi = fai->count - 1;
+
+  while (lo <= hi)
+  {
+    long mid = (lo + hi) / 2;
+    int cmp = strcmp(name, fai->entries[fai->sorted[mid]].name);
+
+    if (!cmp)
+      return fai->sorted[mid];
+    if (cmp < 0)
+      hi = mid - 1;
+    else
+      lo = mid + 1;
+  }
+
+  return -1;
+}
+
+/* fetch bases [start,end) (0-based, clipped to the record) of record i.
+   The returned buffer is overwritten on the next call; it is aligned to
+   SALT_ALIGNMENT_MAX and zero padded up to the next multiple of it */
+char * salt_fai_fetch(salt_fai_t * fai, long i, long start, long end,
+                      long * len)
+{
+  if (i < 0 || i >= fai->count)
+    fatal("Error: Record %ld not in fasta index", i);
+
+  salt_fai_entry_t * e = fai->entries + i;
+
+  if (start < 0)
+    start = 0;
+  if (end > e->len || end < 0)
+    end = e->len;
+  if (end < start)
+    end = start;
+
+  long count = end - start;
+  long padded = roundup(count + 1, SALT_ALIGNMENT_MAX);
+
+  if (padded > fai->buf_alloc)
+  {
+    free(fai->buf);
+    fai->buf = (char *) xmalloc(padded, SALT_ALIGNMENT_MAX);
+    fai->buf_alloc = padded;
+  }
+
+  if (count)
+  {
+    /* bytes spanned by the bases, including line terminators */
+    long first = e->offset + (start / e->linebases) * e->linewidth
+                 + start % e->linebases;
+    long last = e->offset + ((end-1) / e->linebases) * e->linewidth
+                + (end-1) % e->linebases;
+    long raw_len = last - first + 1;
+
+    if (raw_len > fai->raw_alloc)
+    {
+      fai->raw_alloc = raw_len;
+      fai->raw = (char *) xrealloc(fai->raw, raw_len);
+    }
+
+    if (fseek(fai->fp, first, SEEK_SET) ||
+        fread(fai->raw, 1, raw_len, fai->fp) != (size_t)raw_len)
+      fatal("Error: Unable to read record %s from fasta file", e->name);
+
+    long n = 0;
+    for (long j = 0; j < raw_len; ++j)
+      if (fai->raw[j] != '\n' && fai->raw[j] != '\r')
+        fai->buf[n++] = fai->raw[j];
+
+    if (n != count)
+      fatal("Error: Fasta file does not match its index (record %s)",
+            e->name);
+  }
+
+  memset(fai->buf + count, 0, padded - count);
+
+  *len = count;
+  return fai->buf;
+}
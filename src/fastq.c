@@ -0,0 +1,315 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+#include "salt.h"
+
+/* please note that, as for the fasta reader, these functions return
+   pointers to buffers allocated here for the header, sequence and quality
+   string. These buffers will be overwritten on the next call of
+   salt_fastq_getnext. The sequence and quality buffers are aligned to
+   SALT_ALIGNMENT_MAX and zero padded up to the next multiple of it. */
+
+static void fastq_grow(salt_fastq_t * fd, long len)
+{
+  long alloc = fd->seq_alloc;
+
+  while (alloc < roundup(len+1, SALT_ALIGNMENT_MAX))
+    alloc <<= 1;
+
+  if (alloc == fd->seq_alloc)
+    return;
+
+  fd->seq  = (char *) xrealloc_aligned(fd->seq, (size_t)fd->seq_len,
+                                       (size_t)alloc, SALT_ALIGNMENT_MAX);
+  fd->qual = (char *) xrealloc_aligned(fd->qual, (size_t)fd->qual_len,
+                                       (size_t)alloc, SALT_ALIGNMENT_MAX);
+  fd->seq_alloc = alloc;
+}
+
+/* read a complete line of arbitrary length into fd->line, without the
+   trailing newline. Returns 0 at the end of the file */
+static int fastq_readline(salt_fastq_t * fd)
+{
+  fd->line_len = 0;
+  fd->line[0] = 0;
+
+  while (fgets(fd->line + fd->line_len,
+               (int)(fd->line_alloc - fd->line_len),
+               fd->fp))
+  {
+    long len = strlen(fd->line + fd->line_len);
+    fd->line_len += len;
+    fd->filepos += len;
+
+    if (fd->line[fd->line_len-1] == '\n')
+      break;
+
+    if (fd->line_len + 1 == fd->line_alloc)
+    {
+      fd->line_alloc <<= 1;
+      fd->line = (char *) xrealloc(fd->line, (size_t)fd->line_alloc);
+    }
+  }
+
+  if (!fd->line_len)
+    return 0;
+
+  fd->lineno++;
+
+  while (fd->line_len &&
+         (fd->line[fd->line_len-1] == '\n' || fd->line[fd->line_len-1] == '\r'))
+    fd->line[--fd->line_len] = 0;
+
+  return 1;
+}
+
+/* subtract the phred offset from all quality symbols, 16 at a time, and
+   check that they were in the range offset..126 */
+static void fastq_normalize(salt_fastq_t * fd)
+{
+  __m128i xmm0, xmm1, xmm2, xmm3, xmm4;
+  int bad = 0;
+
+  xmm0 = _mm_set1_epi8((char)fd->phred_offset);
+  xmm1 = _mm_set1_epi8(127);
+
+  for (long i = 0; i < fd->qual_len; i += 16)
+  {
+    xmm2 = _mm_load_si128((__m128i *)(fd->qual+i));
+
+    /* symbols below the offset (or above 127, negative as signed) and DEL */
+    xmm3 = _mm_cmpgt_epi8(xmm0, xmm2);
+    xmm4 = _mm_cmpeq_epi8(xmm2, xmm1);
+    xmm3 = _mm_or_si128(xmm3, xmm4);
+
+    /* ignore the padding after the last symbol */
+    int mask = _mm_movemask_epi8(xmm3);
+    if (fd->qual_len - i < 16)
+      mask &= (1 << (fd->qual_len - i)) - 1;
+    bad |= mask;
+
+    xmm2 = _mm_sub_epi8(xmm2, xmm0);
+    _mm_store_si128((__m128i *)(fd->qual+i), xmm2);
+  }
+
+  if (bad)
+    fatal("Error: quality value out of range for offset %ld in fastq "
+          "record ending on line %ld", fd->phred_offset, fd->lineno);
+}
+
+salt_fastq_t * salt_fastq_open(const char * filename)
+{
+  salt_fastq_t * fd = (salt_fastq_t *) xmalloc(sizeof(salt_fastq_t), 8);
+
+  fd->line_alloc = LINEALLOC;
+  fd->line = (char *) xmalloc((size_t)fd->line_alloc, 8);
+  fd->line_len = 0;
+
+  fd->head_alloc = MEMCHUNK;
+  fd->head = (char *) xmalloc((size_t)fd->head_alloc, 8);
+  fd->head_len = 0;
+
+  fd->seq_alloc = MEMCHUNK;
+  fd->seq  = (char *) xmalloc((size_t)fd->seq_alloc, SALT_ALIGNMENT_MAX);
+  fd->qual = (char *) xmalloc((size_t)fd->seq_alloc, SALT_ALIGNMENT_MAX);
+  fd->seq_len = 0;
+  fd->qual_len = 0;
+
+  fd->no = -1;
+  fd->lineno = 0;
+  fd->phred_offset = 0;
+
+  /* "-" for standard input; filesize is -1 if unknown */
+  fd->fp = xfopen_input(filename, &(fd->filesize));
+  fd->filepos = 0;
+
+  /* look ahead at the first header */
+  fastq_readline(fd);
+
+  return fd;
+}
+
+void salt_fastq_close(salt_fastq_t * fd)
+{
+  xfclose_input(fd->fp);
+
+  free(fd->line);
+  free(fd->head);
+  free(fd->seq);
+  free(fd->qual);
+  free(fd);
+}
+
+long salt_fastq_getfilesize(salt_fastq_t * fd)
+{
+  return fd->filesize;
+}
+
+/* bytes consumed so far, also for input that cannot be seeked */
+long salt_fastq_getfilepos(salt_fastq_t * fd)
+{
+  return fd->filepos;
+}
+
+/* quality symbols are returned as they are in the file, unless an offset
+   (usually 33 or 64) is set, in which case the phred scores are returned */
+void salt_fastq_set_phred_offset(salt_fastq_t * fd, long offset)
+{
+  if (offset < 0 || offset > 126)
+    fatal("Error: illegal phred offset %ld", offset);
+
+  fd->phred_offset = offset;
+}
+
+int salt_fastq_getnext(salt_fastq_t * fd, char ** head, long * head_len,
+                       char ** seq, long * seq_len, char ** qual,
+                       long * qno)
+{
+  char msg[200];
+
+  /* skip empty lines between records */
+  while (!fd->line_len)
+    if (!fastq_readline(fd))
+      return 0;
+
+  /* read header */
+
+  if (fd->line[0] != '@')
+    fatal("Illegal header line %ld in fastq file", fd->lineno);
+
+  fd->head_len = fd->line_len - 1;
+  if (fd->head_len + 1 > fd->head_alloc)
+  {
+    fd->head_alloc = fd->head_len + 1;
+    fd->head = (char *) xrealloc(fd->head, (size_t)fd->head_alloc);
+  }
+  memcpy(fd->head, fd->line + 1, (size_t)fd->head_len + 1);
+
+  /* read sequence lines until the separator */
+
+  fd->seq_len = 0;
+  fd->qual_len = 0;
+
+  while (1)
+  {
+    if (!fastq_readline(fd))
+      fatal("Unexpected end of fastq file on line %ld", fd->lineno);
+
+    if (fd->line[0] == '+')
+      break;
+
+    fastq_grow(fd, fd->seq_len + fd->line_len);
+
+    char c;
+    char * p = fd->line;
+    while ((c = *p++))
+    {
+      switch (chrstatus[(unsigned char)c])
+      {
+        case 1:
+          /* legal character */
+          fd->seq[fd->seq_len++] = c;
+          break;
+
+        case 3:
+          /* silently stripped chars */
+          break;
+
+        default:
+          /* stripping would shift the quality string, hence fatal */
+          if (c>=32)
+            snprintf(msg, 200, "illegal character '%c' on line %ld in the fastq file", c, fd->lineno);
+          else
+            snprintf(msg, 200, "illegal unprintable character %#.2x (hexadecimal) on line %ld in the fastq file", c, fd->lineno);
+          fatal(msg);
+      }
+    }
+  }
+
+  /* read quality lines until they cover the sequence */
+
+  while (fd->qual_len < fd->seq_len)
+  {
+    if (!fastq_readline(fd))
+      fatal("Unexpected end of fastq file on line %ld", fd->lineno);
+
+    if (fd->qual_len + fd->line_len > fd->seq_len)
+      break;
+
+    memcpy(fd->qual + fd->qual_len, fd->line, (size_t)fd->line_len);
+    fd->qual_len += fd->line_len;
+  }
+
+  if (fd->qual_len != fd->seq_len)
+    fatal("Sequence and quality lengths differ in fastq record ending on "
+          "line %ld", fd->lineno);
+
+  if (fd->phred_offset)
+    fastq_normalize(fd);
+
+  /* zero the padding of both buffers */
+  long padded_len = roundup(fd->seq_len+1, SALT_ALIGNMENT_MAX);
+  memset(fd->seq + fd->seq_len, 0, (size_t)(padded_len - fd->seq_len));
+  memset(fd->qual + fd->qual_len, 0, (size_t)(padded_len - fd->qual_len));
+
+  /* look ahead at the next header */
+  fastq_readline(fd);
+
+  fd->no++;
+  *head = fd->head;
+  *seq = fd->seq;
+  *qual = fd->qual;
+  *head_len = fd->head_len;
+  *seq_len = fd->seq_len;
+  *qno = fd->no;
+
+  return 1;
+}
+
+/* same as salt_fasta_getbatch, additionally filling the quality arena */
+long salt_fastq_getbatch(salt_fastq_t * fd, salt_batch_t * batch)
+{
+  char * head;
+  char * seq;
+  char * qual;
+  long head_len;
+  long seq_len;
+  long qno;
+  long bases = 0;
+
+  SALT_STAGE_BEGIN;
+
+  salt_batch_reset(batch);
+  batch->first_qno = fd->no + 1;
+
+  while (!salt_batch_full(batch) &&
+         salt_fastq_getnext(fd, &head, &head_len,
+                            &seq, &seq_len, &qual, &qno))
+  {
+    salt_batch_append(batch, head, head_len, seq, seq_len, qual, 1);
+    bases += seq_len;
+  }
+
+  SALT_STAGE_END(SALT_STAGE_PARSE);
+  SALT_STAGE_UNITS(SALT_STAGE_PARSE, bases);
+
+  return batch->count;
+}
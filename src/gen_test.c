@@ -14,11 +14,102 @@ float cprb[] = {0.25, 0.25, 0.25, 0.25}; // sum must be 1
 /*
  * Returns min of the ints
  */
-inline int min (int a, int b)
+static inline int min (int a, int b)
 {
     return a < b ? a : b;
 }
 
+/*
+ * xoshiro256** generator (Blackman & Vigna), seeded through splitmix64.
+ *
+ * Every thread has its own default generator for the functions below, so
+ * they can be used from several threads at once. Code that has to produce
+ * the same data with any number of threads uses a salt_rng_t of its own
+ * per independent unit of work instead.
+ */
+static __thread salt_rng_t thread_rng;
+static __thread int thread_rng_seeded = 0;
+
+static inline uint64_t rotl (uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t splitmix64 (uint64_t * x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+void salt_rng_seed (salt_rng_t * rng, uint64_t seed)
+{
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = splitmix64 (&seed);
+    }
+}
+
+uint64_t salt_rng_next (salt_rng_t * rng)
+{
+    uint64_t * s = rng->s;
+    uint64_t result = rotl (s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl (s[3], 45);
+
+    return result;
+}
+
+/*
+ * Returns a random number in [0, n), without bias (Lemire's method).
+ */
+uint64_t salt_rng_range (salt_rng_t * rng, uint64_t n)
+{
+    unsigned __int128 m = (unsigned __int128) salt_rng_next (rng) * n;
+    uint64_t low = (uint64_t) m;
+
+    if (low < n) {
+        uint64_t threshold = -n % n;
+        while (low < threshold) {
+            m = (unsigned __int128) salt_rng_next (rng) * n;
+            low = (uint64_t) m;
+        }
+    }
+
+    return (uint64_t)(m >> 64);
+}
+
+/*
+ * Returns a random double in [0, 1).
+ */
+double salt_rng_double (salt_rng_t * rng)
+{
+    return (salt_rng_next (rng) >> 11) * 0x1.0p-53;
+}
+
+/*
+ * Seeds the default generator of the calling thread.
+ */
+void random_seed (uint64_t seed)
+{
+    salt_rng_seed (&thread_rng, seed);
+    thread_rng_seeded = 1;
+}
+
+static inline salt_rng_t * default_rng ()
+{
+    if (!thread_rng_seeded) {
+        random_seed (0);
+    }
+    return &thread_rng;
+}
+
 /*
  * Returns a random int within range [min, max).
  *
@@ -27,21 +118,15 @@ inline int min (int a, int b)
 int random_int_range (int min, int max)
 {
     assert (min < max);
-    int ret;
-    int n = max-min;
-    int end = RAND_MAX / n;
-    assert (end>0); // make sure compiler does not optimize too much
-    end *= n;
-    while ((ret = rand()) >= end);
-    return min + (ret % n);
+    return min + (int) salt_rng_range (default_rng(), (uint64_t)(max - min));
 }
 
 /*
- * Returns a random float in range (0, 1).
+ * Returns a random float in range [0, 1).
  */
-inline float random_float ()
+static inline float random_float ()
 {
-    return (float)rand()/(float)RAND_MAX;
+    return (float) salt_rng_double (default_rng());
 }
 
 /*
@@ -112,7 +197,10 @@ void generate_pair (char* seq1, int len1, char* seq2, int len2, int overlap)
 }
 
 /*
- *
+ * Fill total_seq with a random sequence and sample reads_number reads of
+ * random length from it. The reads start at evenly spaced positions (with
+ * some jitter), so that together they cover the sequence; each read is
+ * allocated and null-terminated.
  */
 void generate_reads (int total_len,
                      int reads_number,
@@ -124,11 +212,23 @@ void generate_reads (int total_len,
 {
     // it needs to somehow be possible to cover the total seq with reads
     assert (reads_number * reads_max_len > total_len);
+    assert (reads_min_len > 0 && reads_min_len <= reads_max_len);
 
     generate_sequence (total_seq, total_len);
 
     for (int i = 0; i < reads_number; i++) {
+        int len = min (random_int_range (reads_min_len, reads_max_len + 1),
+                       total_len);
+        long last = total_len - len;
+        long start = reads_number > 1 ? last * i / (reads_number - 1) : 0;
 
+        // move the start by up to half a read, within the sequence
+        start += random_int_range (-len/2, len/2 + 1);
+        start = start < 0 ? 0 : (start > last ? last : start);
+
+        reads[i] = (char *) xmalloc (len + 1, 8);
+        memcpy (reads[i], total_seq + start, len);
+        reads[i][len] = 0;
     }
 }
 
@@ -139,7 +239,7 @@ void induce_errors (char* seq, int len, float prob)
 {
     char c;
     for (int i = 0; i < len; i++) {
-        if (random_float() <= prob) {
+        if (random_float() < prob) {
             // make sure it's actually a different char
             do {
                 c = random_char();
@@ -148,3 +248,350 @@ void induce_errors (char* seq, int len, float prob)
         }
     }
 }
+
+/*
+ * Read simulator
+ *
+ * Reads (or pairs of reads) are sampled uniformly from a random genome
+ * and mutated with substitutions, insertions, deletions and Ns at the
+ * given rates per genome base. A read is taken from the forward or the
+ * reverse strand at random; the mates of a pair face each other from the
+ * two ends of a fragment with normally distributed length (the insert
+ * size). The headers record the origin of every read (0-based start of
+ * the fragment, strand and insert size), and in fastq the qualities mark
+ * correct bases with Q40, substituted and inserted bases with Q10 and Ns
+ * with Q2.
+ *
+ * The reads are simulated in chunks of SALT_SIM_CHUNK reads (or pairs);
+ * each chunk has a generator of its own seeded from the seed and the
+ * chunk number, so the output only depends on the seed and not on the
+ * number of threads. Rounds of chunks are simulated in parallel on a
+ * thread pool and written in order, so memory use does not grow with the
+ * number of reads.
+ */
+
+typedef struct
+{
+    char * buf;
+    long len;
+    long alloc;
+} sim_buffer_t;
+
+typedef struct
+{
+    const salt_sim_t * sim;
+    const char * genome;
+    long first;                 // first chunk of the round
+    sim_buffer_t * out;         // one per chunk of the round
+    sim_buffer_t * mates;       // one per chunk, if mates go to another file
+} sim_job_t;
+
+static const char complement[4] = {'T', 'G', 'C', 'A'};
+
+static inline int base_code (char c)
+{
+    switch (c) {
+        case 'A': return 0;
+        case 'C': return 1;
+        case 'G': return 2;
+        default:  return 3;
+    }
+}
+
+void salt_sim_init (salt_sim_t * sim)
+{
+    sim->genome_len  = 1000000;
+    sim->reads       = 100000;
+    sim->min_len     = 150;
+    sim->max_len     = 150;
+    sim->paired      = 0;
+    sim->insert_mean = 500;
+    sim->insert_sd   = 50;
+    sim->sub_rate    = 0;
+    sim->ins_rate    = 0;
+    sim->del_rate    = 0;
+    sim->n_rate      = 0;
+    sim->format      = SALT_SIM_FASTA;
+    sim->seed        = 0;
+    sim->threads     = 1;
+}
+
+static void sim_check (const salt_sim_t * sim)
+{
+    if (sim->min_len < 1 || sim->max_len < sim->min_len)
+        fatal ("Error: illegal read lengths for the simulation");
+    if (sim->genome_len < sim->max_len)
+        fatal ("Error: the genome must be at least as long as the reads");
+    if (sim->reads < 0 || sim->threads < 1)
+        fatal ("Error: illegal number of reads or threads");
+    if (sim->paired && (sim->insert_mean < 1 || sim->insert_sd < 0))
+        fatal ("Error: illegal insert size");
+    if (sim->sub_rate < 0 || sim->ins_rate < 0 || sim->del_rate < 0 ||
+        sim->n_rate < 0 ||
+        sim->sub_rate + sim->ins_rate + sim->del_rate + sim->n_rate > 1)
+        fatal ("Error: the error rates must be positive and sum up to at "
+               "most 1");
+}
+
+/*
+ * Returns a random genome of sim->genome_len bases, null-terminated.
+ */
+char * salt_sim_genome (const salt_sim_t * sim)
+{
+    salt_rng_t rng;
+    long len = sim->genome_len;
+    char * genome = (char *) xmalloc (len + 1, SALT_ALIGNMENT_MAX);
+
+    salt_rng_seed (&rng, sim->seed);
+
+    // 32 bases out of every random number
+    for (long i = 0; i < len; i += 32) {
+        uint64_t x = salt_rng_next (&rng);
+        long n = len - i < 32 ? len - i : 32;
+        for (long j = 0; j < n; j++, x >>= 2) {
+            genome[i+j] = cmap[x & 3];
+        }
+    }
+    genome[len] = 0;
+
+    return genome;
+}
+
+static void sim_reserve (sim_buffer_t * b, long size)
+{
+    if (b->len + size > b->alloc) {
+        b->alloc = 2 * (b->len + size);
+        b->buf = (char *) xrealloc (b->buf, b->alloc);
+    }
+}
+
+/*
+ * Simulates a read of up to len bases starting at genome position pos,
+ * towards the end of the genome or, on the reverse strand, towards its
+ * start on the complement. Returns the number of bases written.
+ */
+static long sim_read (const salt_sim_t * sim, salt_rng_t * rng,
+                      const char * genome, long pos, long len, int reverse,
+                      char * seq, char * qual)
+{
+    double n_rate = sim->n_rate;
+    double sub_rate = n_rate + sim->sub_rate;
+    double ins_rate = sub_rate + sim->ins_rate;
+    double del_rate = ins_rate + sim->del_rate;
+    long step = reverse ? -1 : 1;
+    long n = 0;
+
+    while (n < len && pos >= 0 && pos < sim->genome_len) {
+        int c = base_code (genome[pos]);
+        if (reverse) {
+            c = 3 - c;
+        }
+
+        double u = del_rate > 0 ? salt_rng_double (rng) : 1;
+
+        if (u < n_rate) {
+            seq[n] = 'N';
+            qual[n++] = '#';
+            pos += step;
+        } else if (u < sub_rate) {
+            seq[n] = cmap[(c + 1 + salt_rng_range (rng, 3)) & 3];
+            qual[n++] = '+';
+            pos += step;
+        } else if (u < ins_rate) {
+            // a random base before the current one
+            seq[n] = cmap[salt_rng_next (rng) & 3];
+            qual[n++] = '+';
+        } else if (u < del_rate) {
+            pos += step;
+        } else {
+            seq[n] = reverse ? complement[3 - c] : genome[pos];
+            qual[n++] = 'I';
+            pos += step;
+        }
+    }
+
+    return n;
+}
+
+static void sim_record (const salt_sim_t * sim, sim_buffer_t * b,
+                        const char * name, const char * seq,
+                        const char * qual, long len)
+{
+    sim_reserve (b, 2 * len + 256);
+
+    char * p = b->buf + b->len;
+
+    p += sprintf (p, "%c%s\n", sim->format == SALT_SIM_FASTQ ? '@' : '>',
+                  name);
+    memcpy (p, seq, len);
+    p += len;
+    *p++ = '\n';
+
+    if (sim->format == SALT_SIM_FASTQ) {
+        *p++ = '+';
+        *p++ = '\n';
+        memcpy (p, qual, len);
+        p += len;
+        *p++ = '\n';
+    }
+
+    b->len = p - b->buf;
+}
+
+static void sim_chunk (sim_job_t * job, long chunk, sim_buffer_t * out,
+                       sim_buffer_t * mates)
+{
+    const salt_sim_t * sim = job->sim;
+    const char * genome = job->genome;
+    long glen = sim->genome_len;
+    long first = chunk * SALT_SIM_CHUNK;
+    long last = first + SALT_SIM_CHUNK;
+    char name[128];
+    salt_rng_t rng;
+
+    // a generator per chunk, independent of the seed of the genome
+    salt_rng_seed (&rng, sim->seed ^ (0x9e3779b97f4a7c15ULL * (chunk + 1)));
+
+    if (last > sim->reads) {
+        last = sim->reads;
+    }
+
+    char * seq = (char *) xmalloc (2 * sim->max_len, 8);
+    char * qual = seq + sim->max_len;
+
+    out->len = 0;
+    if (mates) {
+        mates->len = 0;
+    }
+
+    for (long i = first; i < last; i++) {
+        long len = sim->min_len +
+                   (long) salt_rng_range (&rng, sim->max_len - sim->min_len + 1);
+
+        if (!sim->paired) {
+            int reverse = salt_rng_next (&rng) & 1;
+            long start = (long) salt_rng_range (&rng, glen - len + 1);
+            long n = sim_read (sim, &rng, genome,
+                               reverse ? start + len - 1 : start, len,
+                               reverse, seq, qual);
+
+            snprintf (name, 128, "sim.%ld pos=%ld strand=%c", i + 1, start,
+                      reverse ? '-' : '+');
+            sim_record (sim, out, name, seq, qual, n);
+            continue;
+        }
+
+        // fragment length from a normal distribution (Box-Muller)
+        double u1 = 1 - salt_rng_double (&rng);
+        double u2 = salt_rng_double (&rng);
+        long insert = (long) (sim->insert_mean + sim->insert_sd *
+                              sqrt (-2 * log (u1)) * cos (2 * 3.14159265358979323846 * u2));
+
+        insert = insert < sim->min_len ? sim->min_len : insert;
+        insert = insert > glen ? glen : insert;
+
+        long start = (long) salt_rng_range (&rng, glen - insert + 1);
+        int flip = salt_rng_next (&rng) & 1;
+        long len1 = len < insert ? len : insert;
+        long len2 = sim->min_len +
+                    (long) salt_rng_range (&rng, sim->max_len - sim->min_len + 1);
+
+        len2 = len2 < insert ? len2 : insert;
+
+        for (int mate = 0; mate < 2; mate++) {
+            // mate 1 on the forward strand unless the fragment is flipped
+            int reverse = mate ^ flip;
+            long mlen = mate ? len2 : len1;
+            long n = sim_read (sim, &rng, genome,
+                               reverse ? start + insert - 1 : start, mlen,
+                               reverse, seq, qual);
+
+            snprintf (name, 128, "sim.%ld/%d pos=%ld strand=%c insert=%ld",
+                      i + 1, mate + 1, start, reverse ? '-' : '+', insert);
+            sim_record (sim, (mate && mates) ? mates : out, name, seq, qual,
+                        n);
+        }
+    }
+
+    free (seq);
+}
+
+static void sim_range (long begin, long end, long tid, void * data)
+{
+    sim_job_t * job = (sim_job_t *) data;
+
+    for (long k = begin; k < end; k++) {
+        sim_chunk (job, job->first + k, job->out + k,
+                   job->mates ? job->mates + k : NULL);
+    }
+}
+
+static void sim_write (FILE * fp, sim_buffer_t * b)
+{
+    if (b->len && fwrite (b->buf, 1, (size_t) b->len, fp) != (size_t) b->len)
+        fatal ("Error: Unable to write simulated reads");
+}
+
+/*
+ * Simulates sim->reads reads (or pairs) from the genome and writes them to
+ * out; the second mates of pairs go to mates if it is not NULL, otherwise
+ * they follow the first mates in out. Returns the number of bytes written.
+ */
+long salt_sim_reads (const salt_sim_t * sim, const char * genome,
+                     FILE * out, FILE * mates)
+{
+    sim_check (sim);
+
+    long chunks = (sim->reads + SALT_SIM_CHUNK - 1) / SALT_SIM_CHUNK;
+    long round = 4 * sim->threads;
+    long bytes = 0;
+    sim_job_t job;
+
+    salt_pool_t * pool = sim->threads > 1 ? salt_pool_create (sim->threads)
+                                          : NULL;
+
+    job.sim = sim;
+    job.genome = genome;
+    job.out = (sim_buffer_t *) xmalloc (round * sizeof (sim_buffer_t), 8);
+    memset (job.out, 0, round * sizeof (sim_buffer_t));
+    job.mates = NULL;
+
+    if (mates && sim->paired) {
+        job.mates = (sim_buffer_t *) xmalloc (round * sizeof (sim_buffer_t), 8);
+        memset (job.mates, 0, round * sizeof (sim_buffer_t));
+    }
+
+    for (job.first = 0; job.first < chunks; job.first += round) {
+        long n = chunks - job.first < round ? chunks - job.first : round;
+
+        if (pool) {
+            salt_pool_run (pool, n, 1, sim_range, &job);
+        } else {
+            sim_range (0, n, 0, &job);
+        }
+
+        for (long k = 0; k < n; k++) {
+            sim_write (out, job.out + k);
+            bytes += job.out[k].len;
+            if (job.mates) {
+                sim_write (mates, job.mates + k);
+                bytes += job.mates[k].len;
+            }
+        }
+    }
+
+    for (long k = 0; k < round; k++) {
+        free (job.out[k].buf);
+        if (job.mates) {
+            free (job.mates[k].buf);
+        }
+    }
+    free (job.out);
+    free (job.mates);
+
+    if (pool) {
+        salt_pool_destroy (pool);
+    }
+
+    return bytes;
+}
@@ -0,0 +1,334 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+#include "salt.h"
+
+/*
+
+  (w,k)-minimizer index for overlap candidate generation
+
+  Every k-mer is 2-bit encoded (chrmap_2bit) and hashed with an invertible
+  hash; of every w consecutive k-mers the one with the smallest hash is a
+  minimizer. When both strands are indexed, the hash of a k-mer is the
+  smaller of the hashes of the k-mer and its reverse complement, and the
+  strand of the smaller one is kept. K-mers containing symbols other than
+  ACGTU are skipped.
+
+  The minimizers of all reads are kept in one array sorted by hash. For a
+  query read the matching minimizers of reads with a higher ordinal are
+  collected as hits (read, strand, diagonal), and reads with at least
+  min_hits hits become candidates with the median diagonal of their hits.
+  Minimizers occurring more than max_occ times are ignored, as they come
+  from repeats and only produce spurious candidates.
+
+  The candidate workspace is thread-local, so salt_minimizer_candidates
+  can be called from several threads at once.
+
+*/
+
+static __thread salt_minimizer_t * qmins = NULL;
+static __thread long qmins_alloc = 0;
+static __thread salt_candidate_t * hits = NULL;
+static __thread long hits_alloc = 0;
+
+static uint64_t hash64(uint64_t key, uint64_t mask)
+{
+  key = (~key + (key << 21)) & mask;
+  key = key ^ key >> 24;
+  key = ((key + (key << 3)) + (key << 8)) & mask;
+  key = key ^ key >> 14;
+  key = ((key + (key << 2)) + (key << 4)) & mask;
+  key = key ^ key >> 28;
+  key = (key + (key << 31)) & mask;
+  return key;
+}
+
+static int legal_nt(unsigned char c)
+{
+  switch (c)
+  {
+    case 'A': case 'C': case 'G': case 'T': case 'U':
+    case 'a': case 'c': case 'g': case 't': case 'u':
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+static long push(salt_minimizer_t ** list, long count, long * alloc,
+                 salt_minimizer_t * m)
+{
+  if (count == *alloc)
+  {
+    *alloc = *alloc ? 2 * *alloc : MEMCHUNK;
+    *list = (salt_minimizer_t *) xrealloc(*list, *alloc *
+                                          sizeof(salt_minimizer_t));
+  }
+  (*list)[count] = *m;
+  return count + 1;
+}
+
+/* append the minimizers of one read to *list; returns the new count */
+static long sketch(const char * seq, long len, long read, long k, long w,
+                   int strands, salt_minimizer_t ** list, long count,
+                   long * alloc)
+{
+  uint64_t mask = (k < 32) ? (1ULL << 2*k) - 1 : ~0ULL;
+  uint64_t shift = 2*(k-1);
+  uint64_t kmer[2] = { 0, 0 };
+  salt_minimizer_t ring[SALT_MINIMIZER_MAX_W];
+  salt_minimizer_t min, last;
+  long valid = 0;
+  long pos = 0;
+  long minpos = 0;
+
+  for (long j = 0; j < w; ++j)
+    ring[j].hash = ~0ULL;
+
+  min.hash = ~0ULL;
+  last.hash = ~0ULL;
+  last.pos_strand = 0;
+
+  for (long i = 0; i < len; ++i)
+  {
+    unsigned char c = (unsigned char) seq[i];
+    salt_minimizer_t cur;
+
+    if (legal_nt(c))
+    {
+      uint64_t code = chrmap_2bit[c];
+
+      kmer[0] = ((kmer[0] << 2) | code) & mask;
+      kmer[1] = (kmer[1] >> 2) | ((3ULL - code) << shift);
+      valid++;
+    }
+    else
+      valid = 0;
+
+    cur.hash = ~0ULL;
+    cur.read = (uint32_t) read;
+    cur.pos_strand = 0;
+
+    if (valid >= k)
+    {
+      int strand = (strands == 2 && kmer[1] < kmer[0]) ? 1 : 0;
+
+      /* k-mers equal to their reverse complement have no strand */
+      if (strands == 1 || kmer[0] != kmer[1])
+      {
+        cur.hash = hash64(kmer[strand], mask);
+        cur.pos_strand = (uint32_t)((i - k + 1) << 1 | strand);
+      }
+    }
+
+    /* window of the last w k-mers, rescanned only when its minimum
+       falls out of it */
+    ring[pos] = cur;
+
+    if (cur.hash <= min.hash)
+    {
+      min = cur;
+      minpos = pos;
+    }
+    else if (pos == minpos)
+    {
+      min.hash = ~0ULL;
+      for (long j = 0; j < w; ++j)
+        if (ring[j].hash < min.hash)
+        {
+          min = ring[j];
+          minpos = j;
+        }
+    }
+
+    if (i + 1 >= k + w - 1 && min.hash != ~0ULL &&
+        (min.hash != last.hash || min.pos_strand != last.pos_strand))
+    {
+      count = push(list, count, alloc, &min);
+      last = min;
+    }
+
+    pos = (pos + 1 == w) ? 0 : pos + 1;
+  }
+
+  return count;
+}
+
+static int compare_hash(const void * a, const void * b)
+{
+  uint64_t x = ((const salt_minimizer_t *)a)->hash;
+  uint64_t y = ((const salt_minimizer_t *)b)->hash;
+
+  return (x > y) - (x < y);
+}
+
+salt_mindex_t * salt_minimizer_index(salt_readset_t * reads, long k, long w)
+{
+  salt_batch_t * batch = reads->batch;
+
+  if (k < 1 || k > 31)
+    fatal("Error: minimizer k-mer length must be between 1 and 31");
+  if (w < 1 || w > SALT_MINIMIZER_MAX_W)
+    fatal("Error: minimizer window must be between 1 and %d",
+          SALT_MINIMIZER_MAX_W);
+  if (reads->count > UINT32_MAX)
+    fatal("Error: too many reads for the minimizer index");
+
+  salt_mindex_t * index = (salt_mindex_t *) xmalloc(sizeof(salt_mindex_t), 8);
+
+  index->reads = reads;
+  index->k = k;
+  index->w = w;
+  index->max_occ = 1000;
+  index->min_hits = 2;
+
+  long alloc = 0;
+  index->entries = NULL;
+  index->count = 0;
+
+  for (long i = 0; i < batch->count; ++i)
+    index->count = sketch(SALT_BATCH_SEQ(batch, i), batch->seq_len[i], i,
+                          k, w, reads->strands, &index->entries,
+                          index->count, &alloc);
+
+  qsort(index->entries, index->count, sizeof(salt_minimizer_t), compare_hash);
+
+  return index;
+}
+
+void salt_minimizer_index_destroy(salt_mindex_t * index)
+{
+  free(index->entries);
+  free(index);
+}
+
+/* first entry with the given hash, or count if there is none */
+static long lookup(salt_mindex_t * index, uint64_t hash)
+{
+  long lo = 0;
+  long hi = index->count;
+
+  while (lo < hi)
+  {
+    long mid = lo + (hi - lo) / 2;
+    if (index->entries[mid].hash < hash)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (lo < index->count && index->entries[lo].hash == hash)
+    return lo;
+
+  return index->count;
+}
+
+static int compare_hit(const void * a, const void * b)
+{
+  const salt_candidate_t * x = (const salt_candidate_t *) a;
+  const salt_candidate_t * y = (const salt_candidate_t *) b;
+
+  if (x->d != y->d)
+    return (x->d > y->d) - (x->d < y->d);
+  if (x->strand != y->strand)
+    return x->strand - y->strand;
+  return (x->diag > y->diag) - (x->diag < y->diag);
+}
+
+/* candidate generator for salt_allvsall, data is the index */
+long salt_minimizer_candidates(void * data, long q, salt_candidate_t ** list)
+{
+  salt_mindex_t * index = (salt_mindex_t *) data;
+  salt_batch_t * batch = index->reads->batch;
+  long qlen = batch->seq_len[q];
+  long nhits = 0;
+
+  long n = sketch(SALT_BATCH_SEQ(batch, q), qlen, q, index->k, index->w,
+                  index->reads->strands, &qmins, 0, &qmins_alloc);
+
+  for (long i = 0; i < n; ++i)
+  {
+    salt_minimizer_t * qm = qmins + i;
+    long first = lookup(index, qm->hash);
+    long last = first;
+
+    while (last < index->count && index->entries[last].hash == qm->hash)
+      last++;
+
+    if (last - first > index->max_occ)
+      continue;
+
+    long qpos = qm->pos_strand >> 1;
+
+    for (long j = first; j < last; ++j)
+    {
+      salt_minimizer_t * dm = index->entries + j;
+      long dpos = dm->pos_strand >> 1;
+      int strand = (dm->pos_strand ^ qm->pos_strand) & 1;
+
+      /* every pair is generated once, from its lower ordinal */
+      if ((long)dm->read <= q)
+        continue;
+
+      if (nhits == hits_alloc)
+      {
+        hits_alloc = hits_alloc ? 2*hits_alloc : 256;
+        hits = (salt_candidate_t *) xrealloc(hits, hits_alloc *
+                                             sizeof(salt_candidate_t));
+      }
+
+      salt_candidate_t * hit = hits + nhits++;
+
+      hit->d = dm->read;
+      hit->strand = strand;
+      hit->hits = 1;
+
+      /* on the reverse strand the k-mer starts at qlen-qpos-k in the
+         reverse complemented query */
+      hit->diag = strand ? dpos - (qlen - qpos - index->k) : dpos - qpos;
+    }
+  }
+
+  qsort(hits, nhits, sizeof(salt_candidate_t), compare_hit);
+
+  /* collapse the hits of each read and strand into one candidate with
+     the median diagonal */
+  long count = 0;
+  for (long i = 0; i < nhits; )
+  {
+    long j = i;
+    while (j < nhits && hits[j].d == hits[i].d &&
+           hits[j].strand == hits[i].strand)
+      j++;
+
+    if (j - i >= index->min_hits)
+    {
+      hits[count] = hits[i + (j-i)/2];
+      hits[count].hits = j - i;
+      count++;
+    }
+
+    i = j;
+  }
+
+  *list = hits;
+  return count;
+}
@@ -0,0 +1,636 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+#include "salt.h"
+
+/*
+
+  All-vs-all overlaps of a read set
+
+  The reads of a batch are converted once to 2-bit codes (and, if both
+  strands are requested, reverse complemented) into arenas with the same
+  aligned and zero padded layout as the batch, so that the kernels can be
+  called on them directly.
+
+  For every read q a candidate generator lists the reads d it should be
+  overlapped with. Without a generator all pairs d > q are tried, so every
+  unordered pair is aligned once per strand. The selected kernel computes
+  the best prefix-suffix overlap of each candidate pair; the overlap is
+  reported through the callback if it is long and similar enough. If the
+  generator estimates the diagonal of the overlap (see minimizer.c) and a
+  band is set, only the diagonals within the band are scored, by the
+  banded routine of overlap_nuc4_band.c instead of the selected kernel:
+  the full-matrix kernels cannot be restricted to a band by slicing the
+  reads, as the truncated diagonals at the edges of a slice would be
+  taken for overlaps.
+
+  Overlap coordinates are 0-based half-open and always refer to the
+  forward strand of both reads.
+
+*/
+
+/* kernel wrappers with a common signature */
+
+static void kernel_cpu(salt_scoring_t * s,
+                       BYTE * dseq, BYTE * dend, BYTE * qseq, BYTE * qend,
+                       long * psmscore, long * overlaplen, long * matchcase)
+{
+  salt_overlap_nuc4((char *)dseq, (char *)dend, (char *)qseq, (char *)qend,
+                    s->score_long, psmscore, overlaplen, matchcase);
+}
+
+static void kernel_sse8(salt_scoring_t * s,
+                        BYTE * dseq, BYTE * dend, BYTE * qseq, BYTE * qend,
+                        long * psmscore, long * overlaplen, long * matchcase)
+{
+  salt_overlap_nuc4_sse_8(dseq, dend, qseq, qend,
+                          s->score_char, psmscore, overlaplen, matchcase);
+}
+
+static void kernel_sse8u(salt_scoring_t * s,
+                         BYTE * dseq, BYTE * dend, BYTE * qseq, BYTE * qend,
+                         long * psmscore, long * overlaplen, long * matchcase)
+{
+  salt_overlap_nuc4_sse2_8(dseq, dend, qseq, qend,
+                           s->score_char, psmscore, overlaplen, matchcase);
+}
+
+static void kernel_sse16(salt_scoring_t * s,
+                         BYTE * dseq, BYTE * dend, BYTE * qseq, BYTE * qend,
+                         long * psmscore, long * overlaplen, long * matchcase)
+{
+  salt_overlap_nuc4_sse_16(dseq, dend, qseq, qend,
+                           s->score_word, psmscore, overlaplen, matchcase);
+}
+
+static void kernel_avx8(salt_scoring_t * s,
+                        BYTE * dseq, BYTE * dend, BYTE * qseq, BYTE * qend,
+                        long * psmscore, long * overlaplen, long * matchcase)
+{
+  salt_overlap_nuc4_avx2_8(dseq, dend, qseq, qend,
+                           s->score_char, psmscore, overlaplen, matchcase);
+}
+
+static void kernel_avx16(salt_scoring_t * s,
+                         BYTE * dseq, BYTE * dend, BYTE * qseq, BYTE * qend,
+                         long * psmscore, long * overlaplen, long * matchcase)
+{
+  salt_overlap_nuc4_avx2_16(dseq, dend, qseq, qend,
+                            s->score_word, psmscore, overlaplen, matchcase);
+}
+
+static void kernel_avx8l(salt_scoring_t * s,
+                         BYTE * dseq, BYTE * dend, BYTE * qseq, BYTE * qend,
+                         long * psmscore, long * overlaplen, long * matchcase)
+{
+  salt_overlap_nuc4_avx2_lanes_8(dseq, dend, qseq, qend,
+                                 s->score_char, psmscore, overlaplen,
+                                 matchcase);
+}
+
+static void kernel_avx16l(salt_scoring_t * s,
+                          BYTE * dseq, BYTE * dend, BYTE * qseq, BYTE * qend,
+                          long * psmscore, long * overlaplen, long * matchcase)
+{
+  salt_overlap_nuc4_avx2_lanes_16(dseq, dend, qseq, qend,
+                                  s->score_word, psmscore, overlaplen,
+                                  matchcase);
+}
+
+static void kernel_avx8d(salt_scoring_t * s,
+                         BYTE * dseq, BYTE * dend, BYTE * qseq, BYTE * qend,
+                         long * psmscore, long * overlaplen, long * matchcase)
+{
+  salt_overlap_nuc4_avx2_diagonal_8(dseq, dend, qseq, qend,
+                                    s->score_char, psmscore, overlaplen,
+                                    matchcase);
+}
+
+static void kernel_avx16d(salt_scoring_t * s,
+                          BYTE * dseq, BYTE * dend, BYTE * qseq, BYTE * qend,
+                          long * psmscore, long * overlaplen, long * matchcase)
+{
+  salt_overlap_nuc4_avx2_diagonal_16(dseq, dend, qseq, qend,
+                                     s->score_word, psmscore, overlaplen,
+                                     matchcase);
+}
+
+static void kernel_sse32(salt_scoring_t * s,
+                         BYTE * dseq, BYTE * dend, BYTE * qseq, BYTE * qend,
+                         long * psmscore, long * overlaplen, long * matchcase)
+{
+  salt_overlap_nuc4_sse_32(dseq, dend, qseq, qend,
+                           s->score_char, psmscore, overlaplen, matchcase);
+}
+
+static void kernel_avx32d(salt_scoring_t * s,
+                          BYTE * dseq, BYTE * dend, BYTE * qseq, BYTE * qend,
+                          long * psmscore, long * overlaplen, long * matchcase)
+{
+  salt_overlap_nuc4_avx2_diagonal_32(dseq, dend, qseq, qend,
+                                     s->score_char, psmscore, overlaplen,
+                                     matchcase);
+}
+
+typedef void (*kernel_align_t)(salt_scoring_t * s,
+                               BYTE * dseq, BYTE * dend,
+                               BYTE * qseq, BYTE * qend,
+                               long * psmscore, long * overlaplen,
+                               long * matchcase);
+
+/* the adaptive kernel picks the narrowest cells holding every value of
+   the DP matrix: no cell exceeds min(dlen,qlen) times the largest
+   absolute score in magnitude. The 8 and 16-bit kernels are exact below
+   2^7 and 2^15, the 32-bit ones below 2^31; beyond, the CPU kernel is
+   used */
+static void kernel_auto(salt_scoring_t * s,
+                        BYTE * dseq, BYTE * dend, BYTE * qseq, BYTE * qend,
+                        long * psmscore, long * overlaplen, long * matchcase)
+{
+  static const kernel_align_t sse[3] =
+    { kernel_sse8u, kernel_sse16, kernel_sse32 };
+  static const kernel_align_t avx2[3] =
+    { kernel_avx8d, kernel_avx16d, kernel_avx32d };
+
+  long dlen = dend - dseq;
+  long qlen = qend - qseq;
+  long bound = (dlen < qlen ? dlen : qlen) * s->maxabs;
+  const kernel_align_t * k = __builtin_cpu_supports("avx2") ? avx2 : sse;
+
+  if (bound < (1l << 7))
+    k[0](s, dseq, dend, qseq, qend, psmscore, overlaplen, matchcase);
+  else if (bound < (1l << 15))
+    k[1](s, dseq, dend, qseq, qend, psmscore, overlaplen, matchcase);
+  else if (bound < (1l << 31))
+    k[2](s, dseq, dend, qseq, qend, psmscore, overlaplen, matchcase);
+  else
+    kernel_cpu(s, dseq, dend, qseq, qend, psmscore, overlaplen, matchcase);
+}
+
+/* the names are the ones accepted by the --algorithm toolkit option;
+   SSE8U is the SSE 8-bit kernel computing four columns per pass over the
+   query, AVX8L and AVX16L are the AVX2 kernels with a query segment per
+   128-bit lane, and AVX8D, AVX16D and AVX32D sum the diagonals directly
+   (overlap_nuc4_simd.cc). AUTO selects the kernel of 8, 16 or 32 bits
+   for every pair (kernel_auto) and is exact for all lengths. The column
+   kernels also align against a query profile built once */
+static const salt_kernel_t kernels[] =
+  {
+    { "CPU",   64, 0, kernel_cpu,
+      NULL, NULL },
+    { "SSE8",   8, 0, kernel_sse8,
+      salt_overlap_nuc4_sse_8_profile,
+      salt_overlap_nuc4_sse_8_align },
+    { "SSE8U",  8, 0, kernel_sse8u,
+      salt_overlap_nuc4_sse2_8_profile,
+      salt_overlap_nuc4_sse2_8_align },
+    { "SSE16", 16, 0, kernel_sse16,
+      salt_overlap_nuc4_sse_16_profile,
+      salt_overlap_nuc4_sse_16_align },
+    { "AVX8",   8, 1, kernel_avx8,
+      salt_overlap_nuc4_avx2_8_profile,
+      salt_overlap_nuc4_avx2_8_align },
+    { "AVX16", 16, 1, kernel_avx16,
+      salt_overlap_nuc4_avx2_16_profile,
+      salt_overlap_nuc4_avx2_16_align },
+    { "AVX8L",  8, 1, kernel_avx8l,
+      salt_overlap_nuc4_avx2_lanes_8_profile,
+      salt_overlap_nuc4_avx2_lanes_8_align },
+    { "AVX16L",16, 1, kernel_avx16l,
+      salt_overlap_nuc4_avx2_lanes_16_profile,
+      salt_overlap_nuc4_avx2_lanes_16_align },
+    { "AVX8D",  8, 1, kernel_avx8d,
+      NULL, NULL },
+    { "AVX16D",16, 1, kernel_avx16d,
+      NULL, NULL },
+    { "SSE32", 32, 0, kernel_sse32,
+      salt_overlap_nuc4_sse_32_profile,
+      salt_overlap_nuc4_sse_32_align },
+    { "AVX32D",32, 1, kernel_avx32d,
+      NULL, NULL },
+    { "AUTO",  64, 0, kernel_auto,
+      NULL, NULL },
+  };
+
+long salt_kernel_count()
+{
+  return sizeof(kernels) / sizeof(salt_kernel_t);
+}
+
+const salt_kernel_t * salt_kernel_at(long i)
+{
+  return kernels + i;
+}
+
+/* return the kernel with the given name, or NULL if it does not exist or
+   cannot run on this cpu */
+const salt_kernel_t * salt_kernel_get(const char * name)
+{
+  for (long i = 0; i < salt_kernel_count(); ++i)
+    if (!strcmp(kernels[i].name, name))
+    {
+      if (kernels[i].avx2 && !__builtin_cpu_supports("avx2"))
+        return NULL;
+      return kernels + i;
+    }
+
+  return NULL;
+}
+
+/* can the cells of the kernel hold every value of the DP matrix of a pair
+   of the given lengths; no cell exceeds min(dlen,qlen) times the largest
+   absolute score in magnitude */
+int salt_kernel_fits(const salt_kernel_t * kernel, salt_scoring_t * scoring,
+                     long dlen, long qlen)
+{
+  long len = dlen < qlen ? dlen : qlen;
+
+  if (kernel->bits >= 64)
+    return 1;
+
+  return len * scoring->maxabs < (1L << (kernel->bits - 1));
+}
+
+/* the kernel whose query profile aligns a query of length qlen against
+   many database sequences: the kernel itself if it has query profiles,
+   for AUTO the column kernel of the narrowest cells holding every value
+   of a pair with this query (the diagonal kernels profile the database),
+   otherwise NULL */
+const salt_kernel_t * salt_kernel_profiled(const salt_kernel_t * kernel,
+                                           salt_scoring_t * scoring,
+                                           long qlen)
+{
+  if (kernel->profile)
+    return kernel;
+
+  if (kernel->align != kernel_auto)
+    return NULL;
+
+  int avx2 = __builtin_cpu_supports("avx2");
+  long bound = qlen * scoring->maxabs;
+
+  if (bound < (1l << 7))
+    return salt_kernel_get(avx2 ? "AVX8" : "SSE8U");
+  if (bound < (1l << 15))
+    return salt_kernel_get(avx2 ? "AVX16" : "SSE16");
+  if (bound < (1l << 31))
+    return salt_kernel_get("SSE32");
+
+  return NULL;
+}
+
+/* scoring matrices for 2-bit codes, in the three widths used by the
+   kernels */
+salt_scoring_t * salt_scoring_create(long match, long mismatch)
+{
+  salt_scoring_t * s = (salt_scoring_t *) xmalloc(sizeof(salt_scoring_t),
+                                                  SALT_ALIGNMENT_MAX);
+
+  if (match > 127 || match < -128 || mismatch > 127 || mismatch < -128)
+    fatal("Error: match and mismatch scores must be in the range -128..127");
+
+  for (long i = 0; i < SALT_SCORE_MATRIX_SIZE; ++i)
+    for (long j = 0; j < SALT_SCORE_MATRIX_SIZE; ++j)
+    {
+      long v = (i == j) ? match : mismatch;
+
+      s->score_long[(i<<5) + j] = v;
+      s->score_word[(i<<5) + j] = (WORD) v;
+      s->score_char[(i<<5) + j] = (char) v;
+    }
+
+  s->match = match;
+  s->mismatch = mismatch;
+  s->maxabs = (labs(match) > labs(mismatch)) ? labs(match) : labs(mismatch);
+
+  return s;
+}
+
+void salt_scoring_destroy(salt_scoring_t * s)
+{
+  free(s);
+}
+
+/* turn a kernel result into coordinates and count the matches */
+static void overlap_finish(BYTE * dseq, long dlen, BYTE * qseq, long qlen,
+                           long score, long len, long matchcase,
+                           salt_overlap_t * ovl)
+{
+  long olen, ds, qs;
+
+  /* len is the length of the query prefix (matchcase 0) or of the
+     database prefix (matchcase 1) ending the best diagonal; the diagonal
+     itself is shorter if one read contains the other */
+  if (matchcase == 0)
+  {
+    olen = (len < dlen) ? len : dlen;
+    ds = dlen - olen;
+    qs = len - olen;
+  }
+  else
+  {
+    olen = (len < qlen) ? len : qlen;
+    ds = len - olen;
+    qs = qlen - olen;
+  }
+
+  long matches = 0;
+  for (long i = 0; i < olen; ++i)
+    if (dseq[ds+i] == qseq[qs+i])
+      matches++;
+
+  ovl->dlen = dlen;
+  ovl->qlen = qlen;
+  ovl->score = score;
+  ovl->len = olen;
+  ovl->matchcase = matchcase;
+  ovl->matches = matches;
+  ovl->dstart = ds;
+  ovl->dend = ds + olen;
+  ovl->qstart = qs;
+  ovl->qend = qs + olen;
+}
+
+/* align read d with read q (or its reverse complement) and fill in ovl;
+   the sequences must be 2-bit encoded, aligned and zero padded */
+void salt_overlap_pair(const salt_kernel_t * kernel,
+                       salt_scoring_t * scoring,
+                       BYTE * dseq, long dlen,
+                       BYTE * qseq, long qlen,
+                       salt_overlap_t * ovl)
+{
+  long score, len, matchcase;
+
+  kernel->align(scoring, dseq, dseq + dlen, qseq, qseq + qlen,
+                &score, &len, &matchcase);
+
+  overlap_finish(dseq, dlen, qseq, qlen, score, len, matchcase, ovl);
+}
+
+/* same as salt_overlap_pair, with the query profile of q built by
+   kernel->profile */
+void salt_overlap_pair_profile(const salt_kernel_t * kernel,
+                               const void * profile,
+                               BYTE * dseq, long dlen,
+                               BYTE * qseq, long qlen,
+                               salt_overlap_t * ovl)
+{
+  long score, len, matchcase;
+
+  kernel->align_profile(profile, dseq, dseq + dlen, qseq, qseq + qlen,
+                        &score, &len, &matchcase);
+
+  overlap_finish(dseq, dlen, qseq, qlen, score, len, matchcase, ovl);
+}
+
+/* same as salt_overlap_pair, only scoring the diagonals diag-band to
+   diag+band (position 0 of q against position diag of d) */
+void salt_overlap_pair_band(salt_scoring_t * scoring,
+                            BYTE * dseq, long dlen,
+                            BYTE * qseq, long qlen,
+                            long diag, long band,
+                            salt_overlap_t * ovl)
+{
+  long score, len, matchcase;
+
+  salt_overlap_nuc4_band(dseq, dseq + dlen, qseq, qseq + qlen,
+                         scoring->match, scoring->mismatch, diag, band,
+                         &score, &len, &matchcase);
+
+  overlap_finish(dseq, dlen, qseq, qlen, score, len, matchcase, ovl);
+}
+
+static BYTE * encode_arena(salt_arena_t * a, salt_batch_t * batch,
+                           int reverse)
+{
+  long bases = 0;
+
+  SALT_STAGE_BEGIN;
+
+  BYTE * arena = (BYTE *) salt_arena_alloc(a, (size_t)batch->arena_len + 1,
+                                           SALT_ALIGNMENT_MAX);
+
+  for (long i = 0; i < batch->count; ++i)
+  {
+    long len = batch->seq_len[i];
+    char * src = SALT_BATCH_SEQ(batch, i);
+    BYTE * dst = arena + batch->seq_offset[i];
+    long padded_len = roundup(len+1, SALT_ALIGNMENT_MAX);
+
+    if (reverse)
+      for (long j = 0; j < len; ++j)
+        dst[j] = 3 - chrmap_2bit[(unsigned char)src[len-1-j]];
+    else
+      for (long j = 0; j < len; ++j)
+        dst[j] = chrmap_2bit[(unsigned char)src[j]];
+
+    memset(dst + len, 0, (size_t)(padded_len - len));
+    bases += len;
+  }
+
+  SALT_STAGE_END(SALT_STAGE_ENCODE);
+  SALT_STAGE_UNITS(SALT_STAGE_ENCODE, bases);
+
+  return arena;
+}
+
+/* strands is 1 to overlap the reads as given, 2 to also overlap them with
+   the reverse complement of the query reads */
+salt_readset_t * salt_readset_create(salt_batch_t * batch, int strands)
+{
+  salt_readset_t * reads = (salt_readset_t *) xmalloc(sizeof(salt_readset_t),
+                                                      8);
+
+  if (strands != 1 && strands != 2)
+    fatal("Error: the number of strands must be 1 or 2");
+
+  reads->batch = batch;
+  reads->count = batch->count;
+  reads->strands = strands;
+  /* one block for both strands */
+  reads->arena = salt_arena_create(strands * (batch->arena_len + 1 +
+                                              SALT_ALIGNMENT_MAX),
+                                   salt_arena_default_flags());
+  reads->fwd = encode_arena(reads->arena, batch, 0);
+  reads->rev = (strands == 2) ? encode_arena(reads->arena, batch, 1) : NULL;
+
+  return reads;
+}
+
+void salt_readset_destroy(salt_readset_t * reads)
+{
+  salt_arena_destroy(reads->arena);
+  free(reads);
+}
+
+/* encoded sequence of read i, reverse complemented if strand is 1 */
+BYTE * salt_readset_seq(salt_readset_t * reads, long i, int strand)
+{
+  return (strand ? reads->rev : reads->fwd) + reads->batch->seq_offset[i];
+}
+
+long salt_readset_len(salt_readset_t * reads, long i)
+{
+  return reads->batch->seq_len[i];
+}
+
+void salt_allvsall_init(salt_allvsall_t * opts)
+{
+  opts->kernel = salt_kernel_get("CPU");
+  opts->scoring = NULL;
+  opts->min_overlap = 1;
+  opts->min_identity = 0.0;
+  opts->band = -1;
+  opts->pool = NULL;
+  opts->grain = 16;
+  opts->candidates = NULL;
+  opts->candidates_data = NULL;
+  opts->report = NULL;
+  opts->report_data = NULL;
+}
+
+/* a negative band runs the selected kernel over all diagonals, otherwise
+   the banded routine scores the band and the kernel is not used */
+static int allvsall_pair(salt_readset_t * reads, salt_allvsall_t * opts,
+                         long d, long q, int strand, long diag, long band,
+                         long tid)
+{
+  salt_overlap_t ovl;
+  long qlen = salt_readset_len(reads, q);
+
+  if (band < 0)
+    salt_overlap_pair(opts->kernel, opts->scoring,
+                      salt_readset_seq(reads, d, 0),
+                      salt_readset_len(reads, d),
+                      salt_readset_seq(reads, q, strand), qlen,
+                      &ovl);
+  else
+    salt_overlap_pair_band(opts->scoring,
+                           salt_readset_seq(reads, d, 0),
+                           salt_readset_len(reads, d),
+                           salt_readset_seq(reads, q, strand), qlen,
+                           diag, band, &ovl);
+
+  if (ovl.len < opts->min_overlap || ovl.len == 0)
+    return 0;
+
+  if ((double)ovl.matches < opts->min_identity * (double)ovl.len)
+    return 0;
+
+  ovl.d = d;
+  ovl.q = q;
+  ovl.strand = strand;
+
+  /* map query coordinates back to the forward strand */
+  if (strand)
+  {
+    long qs = ovl.qstart;
+    ovl.qstart = qlen - ovl.qend;
+    ovl.qend = qlen - qs;
+  }
+
+  if (opts->report)
+  {
+    SALT_STAGE_BEGIN;
+    opts->report(&ovl, tid, opts->report_data);
+    SALT_STAGE_END(SALT_STAGE_OUTPUT);
+    SALT_STAGE_UNITS(SALT_STAGE_OUTPUT, 1);
+  }
+
+  return 1;
+}
+
+typedef struct
+{
+  salt_readset_t * reads;
+  salt_allvsall_t * opts;
+  long found;
+} allvsall_job_t;
+
+/* overlap the query reads begin..end-1 with their candidates */
+static void allvsall_range(long begin, long end, long tid, void * data)
+{
+  allvsall_job_t * job = (allvsall_job_t *) data;
+  salt_readset_t * reads = job->reads;
+  salt_allvsall_t * opts = job->opts;
+  salt_candidate_t * list;
+  long found = 0;
+
+  for (long q = begin; q < end; ++q)
+  {
+    if (opts->candidates)
+    {
+      SALT_STAGE_BEGIN;
+      long n = opts->candidates(opts->candidates_data, q, &list);
+      SALT_STAGE_END(SALT_STAGE_CANDIDATES);
+      SALT_STAGE_UNITS(SALT_STAGE_CANDIDATES, n);
+
+      for (long i = 0; i < n; ++i)
+      {
+        if (list[i].strand >= reads->strands)
+          continue;
+        found += allvsall_pair(reads, opts, list[i].d, q, list[i].strand,
+                               list[i].diag, opts->band, tid);
+      }
+    }
+    else
+    {
+      for (long d = q + 1; d < reads->count; ++d)
+        for (int strand = 0; strand < reads->strands; ++strand)
+          found += allvsall_pair(reads, opts, d, q, strand, 0, -1, tid);
+    }
+  }
+
+  __sync_fetch_and_add(&job->found, found);
+}
+
+/* overlap every read with its candidates and return the number of
+   overlaps reported. With a thread pool the queries are distributed in
+   tasks of opts->grain reads, and the report callback and the candidate
+   generator are called from all threads */
+long salt_allvsall(salt_readset_t * reads, salt_allvsall_t * opts)
+{
+  allvsall_job_t job;
+
+  if (!opts->kernel)
+    fatal("Error: no overlap kernel selected");
+
+  salt_scoring_t * scoring = opts->scoring;
+  if (!scoring)
+    opts->scoring = salt_scoring_create(1, -1);
+
+  job.reads = reads;
+  job.opts = opts;
+  job.found = 0;
+
+  if (opts->pool)
+    salt_pool_run(opts->pool, reads->count, opts->grain, allvsall_range, &job);
+  else
+    allvsall_range(0, reads->count, 0, &job);
+
+  if (!scoring)
+  {
+    salt_scoring_destroy(opts->scoring);
+    opts->scoring = NULL;
+  }
+
+  return job.found;
+}
@@ -54,12 +54,6 @@
 
 */
 
-static unsigned long qarray_alloc = 0;
-static unsigned long darray_alloc = 0;
-
-static long * qarray;
-static long * darray;
-
 void salt_overlap_nuc4(char * dseq,
                        char * dend,
                        char * qseq,
@@ -75,14 +69,21 @@ void salt_overlap_nuc4(char * dseq,
   long dlen = dend - dseq;
   long qlen = qend - qseq;
 
-  qarray_alloc = qlen * sizeof(long);
-  darray_alloc = dlen * sizeof(long);
+  SALT_STAGE_BEGIN;
 
-  qarray = (long *) xrealloc(qarray, qarray_alloc);
-  darray = (long *) xrealloc(darray, darray_alloc);
+  /* all buffers of the previous call are released */
+  salt_arena_t * ws = salt_kernel_scratch();
+  salt_arena_reset(ws);
+  long * qarray = (long *) salt_arena_alloc(ws, qlen * sizeof(long),
+                                            sizeof(long));
+  long * darray = (long *) salt_arena_alloc(ws, dlen * sizeof(long),
+                                            sizeof(long));
   da = darray;
 
-  memset (qarray, 0, qarray_alloc);
+  memset (qarray, 0, qlen * sizeof(long));
+
+  SALT_STAGE_END(SALT_STAGE_PROFILE);
+  SALT_STAGE_UNITS(SALT_STAGE_PROFILE, qlen);
 
   /* compute the matrix */
   for (j = 0; j < dlen; ++j) 
@@ -102,6 +103,9 @@ void salt_overlap_nuc4(char * dseq,
     *da++ = qarray[qlen - 1];
   }
 
+  SALT_STAGE_END(SALT_STAGE_DP);
+  SALT_STAGE_UNITS(SALT_STAGE_DP, dlen*qlen);
+
   /* pick the best overlap in non run-through case*/
   *matchcase = 0;
   for (i = 0, score = qarray[0]; i < qlen; ++i)
@@ -123,7 +127,9 @@ void salt_overlap_nuc4(char * dseq,
       *matchcase = 1;
     }
   }
-  
+
+  SALT_STAGE_END(SALT_STAGE_REDUCE);
+
   *psmscore = score;
   *overlaplen = len;
 }
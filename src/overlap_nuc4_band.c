@@ -0,0 +1,148 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+#include "salt.h"
+
+/*
+
+  Optimal prefix-suffix matching restricted to a band of diagonals
+
+  As there are no gaps, the score of an overlap is the sum of the scores
+  along a single diagonal. With a match/mismatch scoring the sum depends
+  only on the number of matches, which is counted 16 symbols at a time.
+  Only the diagonals diag-band..diag+band are scored, where diagonal k
+  aligns position 0 of the query with position k of the database.
+
+  The result is the same as that of the full kernels whenever the best
+  overlap lies within the band: the diagonals are visited in the same
+  order and ties are resolved in the same way.
+
+  input
+
+  dseq, dend, qseq, qend: as for salt_overlap_nuc4, the sequences must
+                          be zero padded to a multiple of 16
+  match, mismatch: scores for aligning equal and different symbols
+  diag: approximate diagonal of the overlap
+  band: number of diagonals on either side of diag to score
+
+  output
+
+  psmscore, overlaplen, matchcase: as for salt_overlap_nuc4
+
+*/
+
+static long diag_matches(BYTE * d, BYTE * q, long len)
+{
+  __m128i xmm0, xmm1;
+  long matches = 0;
+  long i;
+
+  for (i = 0; i + 16 <= len; i += 16)
+  {
+    xmm0 = _mm_loadu_si128((__m128i *)(d+i));
+    xmm1 = _mm_loadu_si128((__m128i *)(q+i));
+    matches += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(xmm0,
+                                                                   xmm1)));
+  }
+
+  for (; i < len; ++i)
+    matches += (d[i] == q[i]);
+
+  return matches;
+}
+
+void salt_overlap_nuc4_band(BYTE * dseq,
+                            BYTE * dend,
+                            BYTE * qseq,
+                            BYTE * qend,
+                            long match,
+                            long mismatch,
+                            long diag,
+                            long band,
+                            long * psmscore,
+                            long * overlaplen,
+                            long * matchcase)
+{
+  long dlen = dend - dseq;
+  long qlen = qend - qseq;
+  long score = 0;
+  long len = 0;
+  long k, m, n;
+  long cells = 0;
+  int first = 1;
+
+  /* the diagonals are scored and reduced at once */
+  SALT_STAGE_BEGIN;
+
+  /* clip the band to the diagonals that exist */
+  long kmin = diag - band;
+  long kmax = diag + band;
+
+  if (kmin < 1 - qlen)
+    kmin = 1 - qlen;
+  if (kmax > dlen - 1)
+    kmax = dlen - 1;
+  if (kmin > kmax)
+    kmin = kmax = (diag < 1 - qlen) ? 1 - qlen : dlen - 1;
+
+  *matchcase = 0;
+
+  /* diagonals ending in the last database symbol, by increasing query
+     prefix length (i = dlen-1-k) */
+  for (k = kmax; k >= kmin && k >= dlen - qlen; --k)
+  {
+    n = (k >= 0) ? dlen - k : dlen;
+    m = diag_matches(dseq + dlen - n, qseq + dlen - 1 - k + 1 - n, n);
+    cells += n;
+
+    long s = m * match + (n - m) * mismatch;
+    if (first || s >= score)
+    {
+      score = s;
+      len = dlen - k;
+      first = 0;
+    }
+  }
+
+  /* diagonals ending in the last query symbol, by increasing database
+     prefix length (j = k+qlen-1) */
+  for (k = kmin; k <= kmax && k <= dlen - qlen; ++k)
+  {
+    n = (k >= 0) ? qlen : qlen + k;
+    m = diag_matches(dseq + k + qlen - n, qseq + qlen - n, n);
+    cells += n;
+
+    long s = m * match + (n - m) * mismatch;
+    if (first || s >= score)
+    {
+      score = s;
+      len = k + qlen;
+      *matchcase = 1;
+      first = 0;
+    }
+  }
+
+  SALT_STAGE_END(SALT_STAGE_DP);
+  SALT_STAGE_UNITS(SALT_STAGE_DP, cells);
+
+  *psmscore = score;
+  *overlaplen = len;
+}
@@ -0,0 +1,1069 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+
+#include "salt.h"
+
+/*
+
+  Optimal prefix-suffix matching with mismatches only, SIMD kernels
+
+  One template generates the kernels for every vector width (ISA) and
+  cell width (BITS). The dynamic programming matrix is computed column
+  by column: cell i of column j is cell i-1 of column j-1 plus the score
+  of aligning q[i] with d[j], so a column is the previous one shifted up
+  by one cell, with the top cell of each vector carried into the next
+  one, plus the profile of d[j]. hh holds the current column and ee the
+  last cell of every column; after the last column the best overlap is
+  picked from hh (prefix of q against suffix of d) and ee (prefix of d
+  against suffix of q).
+
+  The traits below supply the few operations that depend on the ISA (the
+  shift by one cell, which crosses the 128-bit lanes with AVX2) and on
+  the cell width (saturating addition, building the query profile, and
+  extracting a cell). The position of the last query cell within its
+  vector, (qlen-1) % cells, is a template parameter of the DP loop, so
+  that reading the last cell of a column is a single extract; the kernel
+  dispatches once per call to the instance for its query length. COLS
+  columns are computed per pass over hh, keeping the intermediate
+  columns in registers, which saves memory traffic on long queries.
+  Queries of at most SIMD_REGISTER_VECTORS vectors need no hh in memory
+  at all: the whole column stays in registers over the database loop and
+  only the last vector of every column is stored, for the reduction.
+
+  Pairs of reads of the same length, for the lengths of SALT_FIXED_LENGTHS
+  (the usual Illumina read lengths), go to instances with both lengths
+  fixed at compile time: the loop over the query vectors is unrolled
+  completely and the padding and the leftover columns are constants.
+
+  The lane layout (avx2_lanes) avoids the lane crossing of the AVX2
+  shift in the DP loop altogether by giving each 128-bit lane a segment
+  of the query of its own. The diagonal kernels (overlap_diagonal) do
+  without the column recurrence and sum the diagonals of the matrix
+  directly.
+
+  Additions of 8 and 16-bit cells saturate, so a score out of the range
+  of the cells sticks at the bound instead of wrapping around; the
+  results are then wrong but recognizably so (see conform.c). The 32-bit
+  cells, for long sequences, wrap around; the adaptive kernel (AUTO in
+  overlap.c) only uses them where they cannot overflow.
+
+  input
+
+  dseq: pointer to start of database sequence
+  dend: pointer after database sequence
+  qseq: pointer to start of query sequence, aligned to 32 bytes and
+        zero padded to a multiple of 32
+  qend: pointer after query sequence
+  score_matrix: 32x32 matrix of bytes or words with scores for aligning
+                two symbols; the scores fit into 8 bits (see
+                salt_scoring_create), so the 16-bit kernels pack their
+                words back to bytes and the 32-bit kernels take bytes
+
+  output
+
+  psmscore: the best possible score of the alignment
+  overlaplen: length of the best overlap
+  matchcase: 0 if the best score was achieved by aligning a prefix of query with
+             a suffix of database, otherwise 1 if a prefix of database was
+             aligned with a suffix of query.
+
+*/
+
+/* queries of at most this many vectors keep the DP column in registers;
+   the rest of the 16 vector registers hold the carried cells and the
+   profile */
+#define SIMD_REGISTER_VECTORS 12
+
+/* vector operations that do not depend on the cell width */
+
+struct sse
+{
+  typedef __m128i vec;
+  enum { bytes = 16, segments = 1 };
+
+  static inline vec zero() { return _mm_setzero_si128(); }
+
+  static inline vec load(const void * p)
+  {
+    return _mm_load_si128((const __m128i *) p);
+  }
+
+  static inline vec loadu(const void * p)
+  {
+    return _mm_loadu_si128((const __m128i *) p);
+  }
+
+  static inline void store(void * p, vec v)
+  {
+    _mm_store_si128((__m128i *) p, v);
+  }
+
+  /* shift h up by S bytes filling in x, and return the S bytes shifted
+     out at the bottom of t */
+  template <int S> static inline vec shift(vec h, vec x, vec & t)
+  {
+    t = _mm_srli_si128(h, 16 - S);
+    return _mm_or_si128(_mm_slli_si128(h, S), x);
+  }
+
+  /* the cells shifted into the first vector of a column, given the last
+     vector of the previous column */
+  template <int S> static inline vec carry(vec h)
+  {
+    (void) h;
+    return _mm_setzero_si128();
+  }
+};
+
+struct avx2
+{
+  typedef __m256i vec;
+  enum { bytes = 32, segments = 1 };
+
+  static inline vec zero() { return _mm256_setzero_si256(); }
+
+  static inline vec load(const void * p)
+  {
+    return _mm256_load_si256((const __m256i *) p);
+  }
+
+  static inline vec loadu(const void * p)
+  {
+    return _mm256_loadu_si256((const __m256i *) p);
+  }
+
+  static inline void store(void * p, vec v)
+  {
+    _mm256_store_si256((__m256i *) p, v);
+  }
+
+  /* alignr and byte shifts work within the 128-bit lanes, so the bytes
+     crossing from the low to the high lane come from a lane swap */
+  template <int S> static inline vec shift(vec h, vec x, vec & t)
+  {
+    vec z = _mm256_setzero_si256();
+    vec s = _mm256_permute2x128_si256(h, h, 0x01);
+
+    t = _mm256_srli_si256(_mm256_blend_epi32(s, z, 0xf0), 16 - S);
+    return _mm256_or_si256(_mm256_alignr_epi8(h,
+                                              _mm256_blend_epi32(s, z, 0x0f),
+                                              16 - S),
+                           x);
+  }
+
+  template <int S> static inline vec carry(vec h)
+  {
+    (void) h;
+    return _mm256_setzero_si256();
+  }
+};
+
+/* AVX2 without lane crossing in the DP loop: the query is cut into two
+   segments, the low 128-bit lanes of the vectors hold the first and the
+   high lanes the second one, so a column is shifted within the lanes.
+   Only the first cell of the second segment needs a cell from the other
+   lane, the last cell of the first segment in the previous column, which
+   is fetched once per column by carry. The query is padded at the front
+   (see layout), so that its last cell is the last cell of the last
+   vector. Columns can only be computed one at a time. */
+struct avx2_lanes : avx2
+{
+  enum { segments = 2 };
+
+  template <int S> static inline vec shift(vec h, vec x, vec & t)
+  {
+    t = _mm256_srli_si256(h, 16 - S);
+    return _mm256_or_si256(_mm256_slli_si256(h, S), x);
+  }
+
+  template <int S> static inline vec carry(vec h)
+  {
+    return _mm256_srli_si256(_mm256_permute2x128_si256(h, h, 0x08), 16 - S);
+  }
+};
+
+/* operations on cells of BITS bits in the vectors of ISA. profile
+   returns the scores of the query codes q[0..cells-1] against one
+   database symbol, whose scores by query code are the 16 bytes of row */
+
+template <class ISA, int BITS> struct cells;
+
+template <> struct cells<sse, 8>
+{
+  typedef char cell;
+  enum { count = 16 };
+
+  static inline __m128i adds(__m128i a, __m128i b)
+  {
+    return _mm_adds_epi8(a, b);
+  }
+
+  static inline __m128i profile(__m128i row, const BYTE * q)
+  {
+    return _mm_shuffle_epi8(row, _mm_load_si128((const __m128i *) q));
+  }
+
+  template <int N> static inline cell extract(__m128i h)
+  {
+    return (cell) _mm_extract_epi8(h, N);
+  }
+};
+
+template <> struct cells<sse, 16>
+{
+  typedef WORD cell;
+  enum { count = 8 };
+
+  static inline __m128i adds(__m128i a, __m128i b)
+  {
+    return _mm_adds_epi16(a, b);
+  }
+
+  static inline __m128i profile(__m128i row, const BYTE * q)
+  {
+    return _mm_cvtepi8_epi16(_mm_shuffle_epi8(row,
+                               _mm_loadl_epi64((const __m128i *) q)));
+  }
+
+  template <int N> static inline cell extract(__m128i h)
+  {
+    return (cell) _mm_extract_epi16(h, N);
+  }
+};
+
+template <> struct cells<avx2, 8>
+{
+  typedef char cell;
+  enum { count = 32 };
+
+  static inline __m256i adds(__m256i a, __m256i b)
+  {
+    return _mm256_adds_epi8(a, b);
+  }
+
+  static inline __m256i profile(__m128i row, const BYTE * q)
+  {
+    return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(row),
+                               _mm256_load_si256((const __m256i *) q));
+  }
+
+  template <int N> static inline cell extract(__m256i h)
+  {
+    return (cell) _mm256_extract_epi8(h, N);
+  }
+};
+
+template <> struct cells<avx2, 16>
+{
+  typedef WORD cell;
+  enum { count = 16 };
+
+  static inline __m256i adds(__m256i a, __m256i b)
+  {
+    return _mm256_adds_epi16(a, b);
+  }
+
+  static inline __m256i profile(__m128i row, const BYTE * q)
+  {
+    return _mm256_cvtepi8_epi16(_mm_shuffle_epi8(row,
+                                  _mm_load_si128((const __m128i *) q)));
+  }
+
+  template <int N> static inline cell extract(__m256i h)
+  {
+    return (cell) _mm256_extract_epi16(h, N);
+  }
+};
+
+/* 32-bit cells for long sequences. There is no saturating addition of
+   32-bit integers; the caller makes sure that no value of the matrix
+   exceeds the range of the cells (see kernel_auto in overlap.c) */
+
+template <> struct cells<sse, 32>
+{
+  typedef int cell;
+  enum { count = 4 };
+
+  static inline __m128i adds(__m128i a, __m128i b)
+  {
+    return _mm_add_epi32(a, b);
+  }
+
+  static inline __m128i profile(__m128i row, const BYTE * q)
+  {
+    int codes;
+    memcpy(&codes, q, sizeof(int));
+    return _mm_cvtepi8_epi32(_mm_shuffle_epi8(row,
+                               _mm_cvtsi32_si128(codes)));
+  }
+
+  template <int N> static inline cell extract(__m128i h)
+  {
+    return (cell) _mm_extract_epi32(h, N);
+  }
+};
+
+template <> struct cells<avx2, 32>
+{
+  typedef int cell;
+  enum { count = 8 };
+
+  static inline __m256i adds(__m256i a, __m256i b)
+  {
+    return _mm256_add_epi32(a, b);
+  }
+
+  static inline __m256i profile(__m128i row, const BYTE * q)
+  {
+    return _mm256_cvtepi8_epi32(_mm_shuffle_epi8(row,
+                                  _mm_loadl_epi64((const __m128i *) q)));
+  }
+
+  template <int N> static inline cell extract(__m256i h)
+  {
+    return (cell) _mm256_extract_epi32(h, N);
+  }
+};
+
+/* the lane layout uses the cells of avx2 */
+template <> struct cells<avx2_lanes, 8> : cells<avx2, 8> { };
+template <> struct cells<avx2_lanes, 16> : cells<avx2, 16> { };
+
+/* one vector of columns j..j+cols-1, at query position i */
+template <class ISA, int BITS, int COLS>
+static inline void dp_vector(long i, const typename cells<ISA,BITS>::cell
+                             * const * p,
+                             typename cells<ISA,BITS>::cell * hh,
+                             typename ISA::vec * x, typename ISA::vec * h)
+{
+  typedef cells<ISA,BITS> C;
+
+  h[0] = ISA::load(hh + i);
+
+  for (int k = 0; k < COLS; ++k)
+  {
+    typename ISA::vec t;
+    h[k+1] = C::adds(ISA::template shift<BITS/8>(h[k], x[k], t),
+                     ISA::load(p[k] + i));
+    x[k] = t;
+  }
+
+  ISA::store(hh + i, h[COLS]);
+}
+
+/* columns j..j+cols-1 over the whole of hh; N is the position of the
+   last query cell in the last vector. With QP set, the padded query
+   length is QP and the loop is unrolled completely */
+template <class ISA, int BITS, int COLS, int N, long QP>
+static inline void dp_columns(const BYTE * dseq, long j, long qlen_padded,
+                              const typename cells<ISA,BITS>::cell * prof,
+                              typename cells<ISA,BITS>::cell * hh,
+                              typename cells<ISA,BITS>::cell * ee)
+{
+  typedef cells<ISA,BITS> C;
+  typedef typename ISA::vec vec;
+  const typename C::cell * p[COLS];
+  vec x[COLS];
+  vec h[COLS + 1];
+
+  if (QP)
+    qlen_padded = QP;
+
+  static_assert(ISA::segments == 1 || COLS == 1,
+                "a column of the lane layout needs the previous one");
+
+  for (int k = 0; k < COLS; ++k)
+  {
+    p[k] = prof + dseq[j+k] * qlen_padded;
+    x[k] = h[k+1] = ISA::zero();
+  }
+
+  if (ISA::segments > 1)
+    x[0] = ISA::template carry<BITS/8>(ISA::load(hh + qlen_padded
+                                                 - C::count));
+
+  if (QP)
+  {
+#pragma GCC unroll 64
+    for (long i = 0; i < QP; i += C::count)
+      dp_vector<ISA,BITS,COLS>(i, p, hh, x, h);
+  }
+  else
+  {
+    for (long i = 0; i < qlen_padded; i += C::count)
+      dp_vector<ISA,BITS,COLS>(i, p, hh, x, h);
+  }
+
+  for (int k = 0; k < COLS; ++k)
+    ee[j+k] = C::template extract<N>(h[k+1]);
+}
+
+/* with DLEN set the database length is DLEN, and the columns left over
+   by the unrolled loop are known at compile time */
+template <class ISA, int BITS, int COLS, int N, long QP, long DLEN>
+static void dp(const BYTE * dseq, long dlen, long qlen_padded,
+               const typename cells<ISA,BITS>::cell * prof,
+               typename cells<ISA,BITS>::cell * hh,
+               typename cells<ISA,BITS>::cell * ee)
+{
+  long j = 0;
+
+  if (DLEN)
+    dlen = DLEN;
+
+  for ( ; j + COLS <= dlen; j += COLS)
+    dp_columns<ISA,BITS,COLS,N,QP>(dseq, j, qlen_padded, prof, hh, ee);
+
+  for ( ; j < dlen; ++j)
+    dp_columns<ISA,BITS,1,N,QP>(dseq, j, qlen_padded, prof, hh, ee);
+}
+
+/* call the instance of dp for n = (qlen-1) % cells, n <= N */
+template <class ISA, int BITS, int COLS, int N>
+struct dp_dispatch
+{
+  static inline void run(long n, const BYTE * dseq, long dlen,
+                         long qlen_padded,
+                         const typename cells<ISA,BITS>::cell * prof,
+                         typename cells<ISA,BITS>::cell * hh,
+                         typename cells<ISA,BITS>::cell * ee)
+  {
+    if (n == N)
+      dp<ISA,BITS,COLS,N,0,0>(dseq, dlen, qlen_padded, prof, hh, ee);
+    else
+      dp_dispatch<ISA,BITS,COLS,N-1>::run(n, dseq, dlen, qlen_padded, prof,
+                                          hh, ee);
+  }
+};
+
+template <class ISA, int BITS, int COLS>
+struct dp_dispatch<ISA,BITS,COLS,0>
+{
+  static inline void run(long n, const BYTE * dseq, long dlen,
+                         long qlen_padded,
+                         const typename cells<ISA,BITS>::cell * prof,
+                         typename cells<ISA,BITS>::cell * hh,
+                         typename cells<ISA,BITS>::cell * ee)
+  {
+    (void) n;
+    dp<ISA,BITS,COLS,0,0,0>(dseq, dlen, qlen_padded, prof, hh, ee);
+  }
+};
+
+/* the whole column of V vectors in registers over all columns, for
+   queries of at most SIMD_REGISTER_VECTORS vectors; the last vector of
+   every column j is stored at ee + j*cells and the column is only
+   written to hh after the last one */
+template <class ISA, int BITS, int V>
+static void dp_registers(const BYTE * dseq, long dlen,
+                         const typename cells<ISA,BITS>::cell * prof,
+                         typename cells<ISA,BITS>::cell * hh,
+                         typename cells<ISA,BITS>::cell * ee)
+{
+  typedef cells<ISA,BITS> C;
+  typedef typename ISA::vec vec;
+  vec h[V];
+
+#pragma GCC unroll 16
+  for (int v = 0; v < V; ++v)
+    h[v] = ISA::zero();
+
+  for (long j = 0; j < dlen; ++j)
+  {
+    const typename C::cell * p = prof + dseq[j] * (V * C::count);
+    vec x = ISA::template carry<BITS/8>(h[V-1]);
+
+#pragma GCC unroll 16
+    for (int v = 0; v < V; ++v)
+    {
+      vec t;
+      h[v] = C::adds(ISA::template shift<BITS/8>(h[v], x, t),
+                     ISA::load(p + v * C::count));
+      x = t;
+    }
+
+    ISA::store(ee + j * C::count, h[V-1]);
+  }
+
+#pragma GCC unroll 16
+  for (int v = 0; v < V; ++v)
+    ISA::store(hh + v * C::count, h[v]);
+}
+
+/* call the instance of dp_registers for v vectors, v <= V */
+template <class ISA, int BITS, int V>
+struct dp_registers_dispatch
+{
+  static inline void run(long v, const BYTE * dseq, long dlen,
+                         const typename cells<ISA,BITS>::cell * prof,
+                         typename cells<ISA,BITS>::cell * hh,
+                         typename cells<ISA,BITS>::cell * ee)
+  {
+    if (v == V)
+      dp_registers<ISA,BITS,V>(dseq, dlen, prof, hh, ee);
+    else
+      dp_registers_dispatch<ISA,BITS,V-1>::run(v, dseq, dlen, prof, hh, ee);
+  }
+};
+
+template <class ISA, int BITS>
+struct dp_registers_dispatch<ISA,BITS,1>
+{
+  static inline void run(long v, const BYTE * dseq, long dlen,
+                         const typename cells<ISA,BITS>::cell * prof,
+                         typename cells<ISA,BITS>::cell * hh,
+                         typename cells<ISA,BITS>::cell * ee)
+  {
+    (void) v;
+    dp_registers<ISA,BITS,1>(dseq, dlen, prof, hh, ee);
+  }
+};
+
+/* the query codes in the order of the cells in the vectors; for the
+   lane layout the query is padded at the front with codes of 0x80, which
+   are scored 0 by the profile so that the padding cells stay 0, and the
+   lanes of vector v hold the cells v*lc..v*lc+lc-1 of every segment */
+template <class ISA, int BITS>
+static const BYTE * layout(salt_arena_t * ws, const BYTE * qseq, long qlen,
+                           long qlen_padded)
+{
+  if (ISA::segments == 1)
+    return qseq;
+
+  long lc = cells<ISA,BITS>::count / ISA::segments;
+  long seg = qlen_padded / ISA::segments;
+  long pad = qlen_padded - qlen;
+  BYTE * lin = (BYTE *) salt_arena_alloc(ws, qlen_padded, 8);
+  BYTE * q = (BYTE *) salt_arena_alloc(ws, qlen_padded, ISA::bytes);
+
+  memset(lin, 0x80, pad);
+  memcpy(lin + pad, qseq, qlen);
+
+  for (long v = 0; v < seg / lc; ++v)
+    for (long s = 0; s < ISA::segments; ++s)
+      memcpy(q + (v*ISA::segments + s)*lc, lin + s*seg + v*lc, lc);
+
+  return q;
+}
+
+/* hh of the lane layout back in the order of the padded query */
+template <class ISA, int BITS>
+static typename cells<ISA,BITS>::cell * unlayout(salt_arena_t * ws,
+                                                typename cells<ISA,BITS>::cell
+                                                * hh, long qlen_padded)
+{
+  typedef typename cells<ISA,BITS>::cell cell;
+
+  long lc = cells<ISA,BITS>::count / ISA::segments;
+  long seg = qlen_padded / ISA::segments;
+  cell * hq = (cell *) salt_arena_alloc(ws, qlen_padded*sizeof(cell), 8);
+
+  for (long v = 0; v < seg / lc; ++v)
+    for (long s = 0; s < ISA::segments; ++s)
+      memcpy(hq + s*seg + v*lc, hh + (v*ISA::segments + s)*lc,
+             lc*sizeof(cell));
+
+  return hq;
+}
+
+/* the query profile: the scores of the four database symbols against
+   the query cells, in the order of the cells in the vectors */
+template <class ISA, int BITS>
+static void profile(salt_arena_t * ws, const __m128i * rows,
+                    const BYTE * qseq, long qlen, long qlen_padded,
+                    typename cells<ISA,BITS>::cell * prof)
+{
+  typedef cells<ISA,BITS> C;
+
+  const BYTE * q = layout<ISA,BITS>(ws, qseq, qlen, qlen_padded);
+
+  for (long c = 0; c < 4; ++c)
+    for (long i = 0; i < qlen_padded; i += C::count)
+      ISA::store(prof + c*qlen_padded + i, C::profile(rows[c], q + i));
+}
+
+/* query profile kept by the caller over many database sequences (the
+   batch api), freed with free() */
+template <class ISA, int BITS>
+static void * query_profile(const __m128i * rows, BYTE * qseq, BYTE * qend)
+{
+  typedef cells<ISA,BITS> C;
+  typedef typename C::cell cell;
+
+  long qlen = qend - qseq;
+  long qlen_padded = roundup(qlen, C::count);
+  cell * prof = (cell *) xmalloc(4*qlen_padded*sizeof(cell),
+                                 SALT_ALIGNMENT_MAX);
+
+  salt_arena_t * ws = salt_kernel_scratch();
+  salt_arena_reset(ws);
+  profile<ISA,BITS>(ws, rows, qseq, qlen, qlen_padded, prof);
+
+  return prof;
+}
+
+/* rows holds the scores of the four database symbols by query code. L
+   is zero for any lengths, or the length of both sequences for the
+   kernels specialized on one read length, which have all their loop
+   bounds fixed at compile time. qprof is a profile of the query built
+   by query_profile, or NULL to build it here */
+template <class ISA, int BITS, int COLS, long L>
+static void overlap(BYTE * dseq, BYTE * dend, BYTE * qseq, BYTE * qend,
+                    const __m128i * rows,
+                    const typename cells<ISA,BITS>::cell * qprof,
+                    long * psmscore, long * overlaplen, long * matchcase)
+{
+  typedef cells<ISA,BITS> C;
+  typedef typename C::cell cell;
+  enum { QP = (L + C::count - 1) / C::count * C::count };
+
+  long dlen = L ? L : dend - dseq;
+  long qlen = L ? L : qend - qseq;
+  long qlen_padded = L ? (long) QP : roundup(qlen, C::count);
+  long vectors = qlen_padded / C::count;
+
+  /* position of the last query cell in the last vector */
+  long last = (ISA::segments > 1) ? C::count - 1 : (qlen-1) % C::count;
+
+  /* the last cell of column j is ee[j*estride] */
+  long estride = (vectors <= SIMD_REGISTER_VECTORS) ? C::count : 1;
+
+  SALT_STAGE_BEGIN;
+
+  /* all buffers of the previous call are released */
+  salt_arena_t * ws = salt_kernel_scratch();
+  salt_arena_reset(ws);
+  cell * hh = (cell *) salt_arena_alloc(ws, qlen_padded*sizeof(cell),
+                                        ISA::bytes);
+  cell * ee = (cell *) salt_arena_alloc(ws, dlen*estride*sizeof(cell),
+                                        ISA::bytes);
+
+  const cell * prof = qprof;
+  if (!prof)
+  {
+    cell * p = (cell *) salt_arena_alloc(ws, 4*qlen_padded*sizeof(cell),
+                                         ISA::bytes);
+    profile<ISA,BITS>(ws, rows, qseq, qlen, qlen_padded, p);
+    prof = p;
+  }
+
+  for (long i = 0; i < qlen_padded; i += C::count)
+    ISA::store(hh + i, ISA::zero());
+
+  SALT_STAGE_END(SALT_STAGE_PROFILE);
+  SALT_STAGE_UNITS(SALT_STAGE_PROFILE, qlen);
+
+  if (estride > 1)
+  {
+    if (L && QP / C::count <= SIMD_REGISTER_VECTORS)
+      dp_registers<ISA,BITS,(QP / C::count <= SIMD_REGISTER_VECTORS ?
+                             QP / C::count : 1)>(dseq, dlen, prof, hh, ee);
+    else
+      dp_registers_dispatch<ISA,BITS,SIMD_REGISTER_VECTORS>::run(vectors,
+                                                                 dseq, dlen,
+                                                                 prof, hh,
+                                                                 ee);
+    ee += last;
+  }
+  else if (L)
+    dp<ISA,BITS,COLS,(ISA::segments > 1 ? C::count - 1 :
+                      L ? (L-1) % C::count : 0),QP,L>(dseq, dlen,
+                                                      qlen_padded, prof,
+                                                      hh, ee);
+  else
+    dp_dispatch<ISA,BITS,COLS,C::count-1>::run(last, dseq, dlen,
+                                               qlen_padded, prof, hh, ee);
+
+  SALT_STAGE_END(SALT_STAGE_DP);
+  SALT_STAGE_UNITS(SALT_STAGE_DP, dlen*qlen);
+
+  /* the query cells in their order, after the front padding */
+  if (ISA::segments > 1)
+    hh = unlayout<ISA,BITS>(ws, hh, qlen_padded) + qlen_padded - qlen;
+
+  /* pick the best values */
+  long len = 0;
+  cell score = hh[0];
+  *matchcase = 0;
+  for (long i = 0; i < qlen; ++i)
+  {
+    if (hh[i] >= score)
+    {
+      len = i+1;
+      score = hh[i];
+    }
+  }
+
+  /* check the run-through case */
+  for (long i = 0; i < dlen; ++i)
+  {
+    if (ee[i*estride] >= score)
+    {
+      len = i+1;
+      score = ee[i*estride];
+      *matchcase = 1;
+    }
+  }
+
+  SALT_STAGE_END(SALT_STAGE_REDUCE);
+
+  *psmscore = score;
+  *overlaplen = len;
+}
+
+/* pick the kernel specialized on the read length when both sequences
+   have one of the lengths of SALT_FIXED_LENGTHS */
+template <class ISA, int BITS, int COLS>
+static void overlap_any(BYTE * dseq, BYTE * dend, BYTE * qseq, BYTE * qend,
+                        const __m128i * rows,
+                        const typename cells<ISA,BITS>::cell * qprof,
+                        long * psmscore, long * overlaplen, long * matchcase)
+{
+  long len = qend - qseq;
+
+  if (dend - dseq == len)
+  {
+#define SALT_FIXED_KERNEL(L)                                               \
+    if (len == L)                                                          \
+    {                                                                      \
+      overlap<ISA,BITS,COLS,L>(dseq, dend, qseq, qend, rows, qprof,        \
+                               psmscore, overlaplen, matchcase);           \
+      return;                                                              \
+    }
+    SALT_FIXED_LENGTHS(SALT_FIXED_KERNEL)
+#undef SALT_FIXED_KERNEL
+  }
+
+  overlap<ISA,BITS,COLS,0>(dseq, dend, qseq, qend, rows, qprof,
+                           psmscore, overlaplen, matchcase);
+}
+
+/* diagonals summed in one pass of the diagonal kernels, in vectors */
+#define SIMD_DIAGONAL_VECTORS 4
+
+/* Diagonal kernels. Cell (i,j) of the DP matrix is the sum of the scores
+   along its diagonal up to the first row or column, so the last cell of
+   column j (ee[j]) and the cells of the last column (hh) are the sums of
+   whole diagonals. With u = j - i + qlen-1 the index of a diagonal,
+
+     D[u] = sum over k of score(q[k], d[k+u-(qlen-1)]),
+
+   hh[i] = D[dlen-1-i+qlen-1] and ee[j] = D[j]. The database is padded
+   with qlen-1 codes of 0x80 on either side, which are scored 0, and its
+   profile P by query symbol is built once; D is then accumulated for
+   SIMD_DIAGONAL_VECTORS vectors of consecutive diagonals at a time by
+   adding the unaligned vectors P[q[k]] + k + u for all k. The sums of
+   different diagonals are independent, there is no carry from one
+   vector to the next, and the query positions whose vectors are all
+   padding are skipped. The profile takes the scores of a query symbol
+   by database symbol from the rows of the (symmetric) score matrix. */
+template <class ISA, int BITS>
+static void overlap_diagonal(BYTE * dseq, BYTE * dend, BYTE * qseq,
+                             BYTE * qend, const __m128i * rows,
+                             long * psmscore, long * overlaplen,
+                             long * matchcase)
+{
+  typedef cells<ISA,BITS> C;
+  typedef typename C::cell cell;
+  typedef typename ISA::vec vec;
+  enum { B = SIMD_DIAGONAL_VECTORS, W = SIMD_DIAGONAL_VECTORS * C::count };
+
+  long dlen = dend - dseq;
+  long qlen = qend - qseq;
+  long diagonals = roundup(qlen + dlen - 1, W);
+  long plen = roundup(qlen + diagonals, C::count);
+
+  SALT_STAGE_BEGIN;
+
+  salt_arena_t * ws = salt_kernel_scratch();
+  salt_arena_reset(ws);
+  BYTE * dpad = (BYTE *) salt_arena_alloc(ws, plen, ISA::bytes);
+  cell * prof = (cell *) salt_arena_alloc(ws, 4*plen*sizeof(cell),
+                                          ISA::bytes);
+  cell * dd = (cell *) salt_arena_alloc(ws, diagonals*sizeof(cell),
+                                        ISA::bytes);
+
+  memset(dpad, 0x80, plen);
+  memcpy(dpad + qlen - 1, dseq, dlen);
+
+  for (long c = 0; c < 4; ++c)
+    for (long y = 0; y < plen; y += C::count)
+      ISA::store(prof + c*plen + y, C::profile(rows[c], dpad + y));
+
+  SALT_STAGE_END(SALT_STAGE_PROFILE);
+  SALT_STAGE_UNITS(SALT_STAGE_PROFILE, dlen);
+
+  for (long u = 0; u < diagonals; u += W)
+  {
+    /* the query positions reaching the database from one of the
+       diagonals u..u+W-1 */
+    long k0 = qlen - u - W;
+    long k1 = qlen - 1 + dlen - u;
+    if (k0 < 0)
+      k0 = 0;
+    if (k1 > qlen)
+      k1 = qlen;
+
+    vec acc[B];
+    for (int b = 0; b < B; ++b)
+      acc[b] = ISA::zero();
+
+    for (long k = k0; k < k1; ++k)
+    {
+      const cell * p = prof + qseq[k]*plen + k + u;
+      for (int b = 0; b < B; ++b)
+        acc[b] = C::adds(acc[b], ISA::loadu(p + b*C::count));
+    }
+
+    for (int b = 0; b < B; ++b)
+      ISA::store(dd + u + b*C::count, acc[b]);
+  }
+
+  SALT_STAGE_END(SALT_STAGE_DP);
+  SALT_STAGE_UNITS(SALT_STAGE_DP, dlen*qlen);
+
+  /* pick the best values, in the order of the other kernels */
+  cell * hh = dd + dlen - 1 + qlen - 1;
+  long len = 0;
+  cell score = hh[0];
+  *matchcase = 0;
+  for (long i = 0; i < qlen; ++i)
+  {
+    if (hh[-i] >= score)
+    {
+      len = i+1;
+      score = hh[-i];
+    }
+  }
+
+  /* check the run-through case */
+  for (long i = 0; i < dlen; ++i)
+  {
+    if (dd[i] >= score)
+    {
+      len = i+1;
+      score = dd[i];
+      *matchcase = 1;
+    }
+  }
+
+  SALT_STAGE_END(SALT_STAGE_REDUCE);
+
+  *psmscore = score;
+  *overlaplen = len;
+}
+
+/* the first 16 scores of the rows A, C, G and T of a score matrix */
+static inline void rows_char(const char * m, __m128i * rows)
+{
+  for (long c = 0; c < 4; ++c)
+    rows[c] = _mm_load_si128((const __m128i *)(m + (c << 5)));
+}
+
+static inline void rows_word(const WORD * m, __m128i * rows)
+{
+  for (long c = 0; c < 4; ++c)
+    rows[c] = _mm_packs_epi16(_mm_load_si128((const __m128i *)(m + (c << 5))),
+                              _mm_load_si128((const __m128i *)(m + (c << 5)
+                                                               + 8)));
+}
+
+/* the kernels of the kernel table (overlap.c) */
+
+void salt_overlap_nuc4_sse_8(BYTE * dseq, BYTE * dend,
+                             BYTE * qseq, BYTE * qend,
+                             char * score_matrix,
+                             long * psmscore,
+                             long * overlaplen,
+                             long * matchcase)
+{
+  __m128i rows[4];
+  rows_char(score_matrix, rows);
+  overlap_any<sse,8,1>(dseq, dend, qseq, qend, rows, NULL,
+                       psmscore, overlaplen, matchcase);
+}
+
+void salt_overlap_nuc4_sse2_8(BYTE * dseq, BYTE * dend,
+                              BYTE * qseq, BYTE * qend,
+                              char * score_matrix,
+                              long * psmscore,
+                              long * overlaplen,
+                              long * matchcase)
+{
+  __m128i rows[4];
+  rows_char(score_matrix, rows);
+  overlap_any<sse,8,4>(dseq, dend, qseq, qend, rows, NULL,
+                       psmscore, overlaplen, matchcase);
+}
+
+void salt_overlap_nuc4_sse_16(BYTE * dseq, BYTE * dend,
+                              BYTE * qseq, BYTE * qend,
+                              WORD * score_matrix,
+                              long * psmscore,
+                              long * overlaplen,
+                              long * matchcase)
+{
+  __m128i rows[4];
+  rows_word(score_matrix, rows);
+  overlap_any<sse,16,1>(dseq, dend, qseq, qend, rows, NULL,
+                        psmscore, overlaplen, matchcase);
+}
+
+void salt_overlap_nuc4_avx2_8(BYTE * dseq, BYTE * dend,
+                              BYTE * qseq, BYTE * qend,
+                              char * score_matrix,
+                              long * psmscore,
+                              long * overlaplen,
+                              long * matchcase)
+{
+  __m128i rows[4];
+  rows_char(score_matrix, rows);
+  overlap_any<avx2,8,1>(dseq, dend, qseq, qend, rows, NULL,
+                        psmscore, overlaplen, matchcase);
+}
+
+void salt_overlap_nuc4_avx2_16(BYTE * dseq, BYTE * dend,
+                               BYTE * qseq, BYTE * qend,
+                               WORD * score_matrix,
+                               long * psmscore,
+                               long * overlaplen,
+                               long * matchcase)
+{
+  __m128i rows[4];
+  rows_word(score_matrix, rows);
+  overlap_any<avx2,16,1>(dseq, dend, qseq, qend, rows, NULL,
+                         psmscore, overlaplen, matchcase);
+}
+
+void salt_overlap_nuc4_avx2_lanes_8(BYTE * dseq, BYTE * dend,
+                                    BYTE * qseq, BYTE * qend,
+                                    char * score_matrix,
+                                    long * psmscore,
+                                    long * overlaplen,
+                                    long * matchcase)
+{
+  __m128i rows[4];
+  rows_char(score_matrix, rows);
+  overlap_any<avx2_lanes,8,1>(dseq, dend, qseq, qend, rows, NULL,
+                              psmscore, overlaplen, matchcase);
+}
+
+void salt_overlap_nuc4_avx2_lanes_16(BYTE * dseq, BYTE * dend,
+                                     BYTE * qseq, BYTE * qend,
+                                     WORD * score_matrix,
+                                     long * psmscore,
+                                     long * overlaplen,
+                                     long * matchcase)
+{
+  __m128i rows[4];
+  rows_word(score_matrix, rows);
+  overlap_any<avx2_lanes,16,1>(dseq, dend, qseq, qend, rows, NULL,
+                               psmscore, overlaplen, matchcase);
+}
+
+void salt_overlap_nuc4_avx2_diagonal_8(BYTE * dseq, BYTE * dend,
+                                       BYTE * qseq, BYTE * qend,
+                                       char * score_matrix,
+                                       long * psmscore,
+                                       long * overlaplen,
+                                       long * matchcase)
+{
+  __m128i rows[4];
+  rows_char(score_matrix, rows);
+  overlap_diagonal<avx2,8>(dseq, dend, qseq, qend, rows,
+                           psmscore, overlaplen, matchcase);
+}
+
+void salt_overlap_nuc4_avx2_diagonal_16(BYTE * dseq, BYTE * dend,
+                                        BYTE * qseq, BYTE * qend,
+                                        WORD * score_matrix,
+                                        long * psmscore,
+                                        long * overlaplen,
+                                        long * matchcase)
+{
+  __m128i rows[4];
+  rows_word(score_matrix, rows);
+  overlap_diagonal<avx2,16>(dseq, dend, qseq, qend, rows,
+                            psmscore, overlaplen, matchcase);
+}
+
+void salt_overlap_nuc4_sse_32(BYTE * dseq, BYTE * dend,
+                              BYTE * qseq, BYTE * qend,
+                              char * score_matrix,
+                              long * psmscore,
+                              long * overlaplen,
+                              long * matchcase)
+{
+  __m128i rows[4];
+  rows_char(score_matrix, rows);
+  overlap<sse,32,1,0>(dseq, dend, qseq, qend, rows, NULL,
+                      psmscore, overlaplen, matchcase);
+}
+
+void salt_overlap_nuc4_avx2_diagonal_32(BYTE * dseq, BYTE * dend,
+                                        BYTE * qseq, BYTE * qend,
+                                        char * score_matrix,
+                                        long * psmscore,
+                                        long * overlaplen,
+                                        long * matchcase)
+{
+  __m128i rows[4];
+  rows_char(score_matrix, rows);
+  overlap_diagonal<avx2,32>(dseq, dend, qseq, qend, rows,
+                            psmscore, overlaplen, matchcase);
+}
+
+/* query profiles of the column kernels, for aligning one query against
+   many database sequences (kernel->profile and kernel->align_profile in
+   overlap.c). The profile only depends on the query and the scores; the
+   8-bit rows of the score matrix are the rows of every cell width */
+#define SALT_PROFILE_KERNEL(NAME, ISA, BITS, COLS)                         \
+void * salt_overlap_nuc4_##NAME##_profile(salt_scoring_t * scoring,        \
+                                          BYTE * qseq, BYTE * qend)        \
+{                                                                          \
+  __m128i rows[4];                                                         \
+  rows_char(scoring->score_char, rows);                                    \
+  return query_profile<ISA,BITS>(rows, qseq, qend);                        \
+}                                                                          \
+                                                                           \
+void salt_overlap_nuc4_##NAME##_align(const void * profile,                \
+                                      BYTE * dseq, BYTE * dend,            \
+                                      BYTE * qseq, BYTE * qend,            \
+                                      long * psmscore,                     \
+                                      long * overlaplen,                   \
+                                      long * matchcase)                    \
+{                                                                          \
+  overlap_any<ISA,BITS,COLS>(dseq, dend, qseq, qend, NULL,                 \
+                             (const cells<ISA,BITS>::cell *) profile,      \
+                             psmscore, overlaplen, matchcase);             \
+}
+
+SALT_PROFILE_KERNEL(sse_8, sse, 8, 1)
+SALT_PROFILE_KERNEL(sse2_8, sse, 8, 4)
+SALT_PROFILE_KERNEL(sse_16, sse, 16, 1)
+SALT_PROFILE_KERNEL(avx2_8, avx2, 8, 1)
+SALT_PROFILE_KERNEL(avx2_16, avx2, 16, 1)
+SALT_PROFILE_KERNEL(avx2_lanes_8, avx2_lanes, 8, 1)
+SALT_PROFILE_KERNEL(avx2_lanes_16, avx2_lanes, 16, 1)
+SALT_PROFILE_KERNEL(sse_32, sse, 32, 1)
+
+#undef SALT_PROFILE_KERNEL
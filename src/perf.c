@@ -0,0 +1,204 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+
+#define _GNU_SOURCE
+
+#include "salt.h"
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+/*
+
+  Hardware performance counters of the calling thread (Linux perf events)
+
+  Cycles, instructions, L1 data cache read misses, last level cache loads
+  and misses, and branch misses are counted in user space for the thread
+  that opens the counters. There is no generic event for the L2 cache;
+  as the last level cache is only accessed on an L2 miss, the LLC loads
+  stand in for the L2 misses. Events the cpu or the kernel does not
+  support (for instance in virtual machines, or with a restrictive
+  perf_event_paranoid) are left out and marked in the mask.
+
+  The counters are read with rdpmc from user space where the kernel allows
+  it, which only costs a few dozen cycles, and with read() otherwise. If
+  more events are open than the cpu has counters, the kernel multiplexes
+  them and the counts are lower than the real ones.
+
+*/
+
+static const char * perf_names[SALT_PERF_EVENTS] =
+  { "cycles", "instructions", "L1D-misses", "LLC-loads", "LLC-misses",
+    "br-misses" };
+
+static void perf_attr(struct perf_event_attr * attr, int event)
+{
+  memset(attr, 0, sizeof(struct perf_event_attr));
+  attr->size = sizeof(struct perf_event_attr);
+  attr->exclude_kernel = 1;
+  attr->exclude_hv = 1;
+
+  switch (event)
+  {
+    case SALT_PERF_CYCLES:
+      attr->type = PERF_TYPE_HARDWARE;
+      attr->config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case SALT_PERF_INSTRUCTIONS:
+      attr->type = PERF_TYPE_HARDWARE;
+      attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case SALT_PERF_L1D_MISSES:
+      attr->type = PERF_TYPE_HW_CACHE;
+      attr->config = PERF_COUNT_HW_CACHE_L1D |
+                     (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    case SALT_PERF_LLC_LOADS:
+      attr->type = PERF_TYPE_HW_CACHE;
+      attr->config = PERF_COUNT_HW_CACHE_LL |
+                     (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                     (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
+      break;
+    case SALT_PERF_LLC_MISSES:
+      attr->type = PERF_TYPE_HW_CACHE;
+      attr->config = PERF_COUNT_HW_CACHE_LL |
+                     (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    case SALT_PERF_BRANCH_MISSES:
+      attr->type = PERF_TYPE_HARDWARE;
+      attr->config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+  }
+}
+
+/* open the counters for the calling thread; NULL if none is available */
+salt_perf_t * salt_perf_open()
+{
+  salt_perf_t * perf = (salt_perf_t *) xmalloc(sizeof(salt_perf_t), 8);
+  long pagesize = sysconf(_SC_PAGESIZE);
+  struct perf_event_attr attr;
+
+  perf->mask = 0;
+
+  for (int e = 0; e < SALT_PERF_EVENTS; ++e)
+  {
+    perf_attr(&attr, e);
+
+    perf->page[e] = NULL;
+    perf->fd[e] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+
+    if (perf->fd[e] < 0)
+      continue;
+
+    perf->mask |= 1u << e;
+
+    /* the first page tells whether rdpmc can be used */
+    void * page = mmap(NULL, pagesize, PROT_READ, MAP_SHARED, perf->fd[e], 0);
+    if (page != MAP_FAILED)
+      perf->page[e] = page;
+  }
+
+  if (!perf->mask)
+  {
+    free(perf);
+    return NULL;
+  }
+
+  return perf;
+}
+
+static uint64_t perf_read_fd(int fd)
+{
+  uint64_t value = 0;
+
+  if (read(fd, &value, sizeof(uint64_t)) != sizeof(uint64_t))
+    return 0;
+
+  return value;
+}
+
+static uint64_t perf_read_event(salt_perf_t * perf, int e)
+{
+  struct perf_event_mmap_page * pc = perf->page[e];
+
+  if (!pc)
+    return perf_read_fd(perf->fd[e]);
+
+  uint32_t seq;
+  uint64_t count;
+
+  do
+  {
+    seq = pc->lock;
+    __sync_synchronize();
+
+    uint32_t index = pc->index;
+
+    if (!pc->cap_user_rdpmc || !index)
+      return perf_read_fd(perf->fd[e]);
+
+    /* the counter is pmc_width bits wide and signed */
+    int64_t pmc = (int64_t) __rdpmc(index - 1);
+    pmc <<= 64 - pc->pmc_width;
+    pmc >>= 64 - pc->pmc_width;
+
+    count = pc->offset + pmc;
+
+    __sync_synchronize();
+  }
+  while (pc->lock != seq);
+
+  return count;
+}
+
+/* current values of the counters; 0 for those not available */
+void salt_perf_read(salt_perf_t * perf, uint64_t * values)
+{
+  for (int e = 0; e < SALT_PERF_EVENTS; ++e)
+    values[e] = (perf->mask & (1u << e)) ? perf_read_event(perf, e) : 0;
+}
+
+void salt_perf_close(salt_perf_t * perf)
+{
+  long pagesize = sysconf(_SC_PAGESIZE);
+
+  for (int e = 0; e < SALT_PERF_EVENTS; ++e)
+  {
+    if (perf->page[e])
+      munmap(perf->page[e], pagesize);
+    if (perf->fd[e] >= 0)
+      close(perf->fd[e]);
+  }
+
+  free(perf);
+}
+
+const char * salt_perf_name(int event)
+{
+  if (event < 0 || event >= SALT_PERF_EVENTS)
+    return NULL;
+
+  return perf_names[event];
+}
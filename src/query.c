@@ -27,6 +27,9 @@
 
 static salt_fasta_t ** of = NULL;
 static int of_count = 0;
+
+/* the registry of open files is shared by all threads */
+static pthread_mutex_t of_mutex = PTHREAD_MUTEX_INITIALIZER;
 /*
 extern unsigned int chrstatus[256];
 
@@ -71,6 +74,11 @@ static salt_fasta_t * init_file_descriptor(int i)
 
   of[i]->filesize =  0;
 
+  of[i]->linepos   =  0;
+  of[i]->range_end = -1;
+
+  of[i]->win_inrecord = 0;
+
   of[i]->ofid = i;
 
   return of[i];
@@ -81,14 +89,27 @@ long salt_fasta_getfilesize(salt_fasta_t * fd)
   return fd->filesize;
 }
 
+/* bytes consumed so far, also for input that cannot be seeked */
 long salt_fasta_getfilepos(salt_fasta_t * fd)
 {
-  return ftell(fd->fp);
+  return fd->linepos;
+}
+
+/* move to the next line (or the next LINEALLOC-1 bytes of a long line),
+   keeping track of the file offset at which it starts */
+static void fasta_nextline(salt_fasta_t * fd)
+{
+  fd->linepos += strlen(fd->line);
+  fd->line[0] = 0;
+  fgets(fd->line, LINEALLOC, fd->fp);
+  fd->lineno++;
 }
 
 salt_fasta_t * salt_fasta_open(const char * filename)
 {
+  pthread_mutex_lock(&of_mutex);
   salt_fasta_t * fd = init_file_descriptor(of_count++);
+  pthread_mutex_unlock(&of_mutex);
 
   if (regcomp(&(fd->q_regexp),
               "(^|;)size=([0-9]+)(;|$)",
@@ -114,18 +135,8 @@ salt_fasta_t * salt_fasta_open(const char * filename)
 
   fd->no = -1;
 
-  /* open queyfile */
-  fd->fp = NULL;
-  fd->fp = fopen(filename, "r");
-  if (!fd->fp)
-    fatal("Error: Unable to open query file (%s)", filename);
-
-  if (fseek(fd->fp, 0, SEEK_END))
-    fatal("Error: Unable to seek in query file (%s)", filename);
-
-  fd->filesize = ftell(fd->fp);
-
-  rewind(fd->fp);
+  /* open queryfile, "-" for standard input; filesize is -1 if unknown */
+  fd->fp = xfopen_input(filename, &(fd->filesize));
 
   fd->line[0] = 0;
   fgets(fd->line, LINEALLOC, fd->fp);
@@ -138,20 +149,25 @@ salt_fasta_t * salt_fasta_open(const char * filename)
   return fd;
 }
 
-void salt_fasta_close(salt_fasta_t * fd)
+static void fasta_warn_stripped(long stripped_count, long * stripped)
 {
   /* Warn about stripped chars */
 
-  if (fd->stripped_count)
+  if (stripped_count)
     {
       fprintf(stderr, "Warning: invalid characters stripped from query:");
       for (int i=0; i<256;i++)
-        if (fd->stripped[i])
-          fprintf(stderr, " %c(%ld)", i, fd->stripped[i]);
+        if (stripped[i])
+          fprintf(stderr, " %c(%ld)", i, stripped[i]);
       fprintf(stderr, "\n");
     }
+}
+
+static void fasta_free(salt_fasta_t * fd)
+{
+  xfclose_input(fd->fp);
 
-  fclose(fd->fp);
+  regfree(&(fd->q_regexp));
 
   if (fd->seq)
     free(fd->seq);
@@ -161,60 +177,121 @@ void salt_fasta_close(salt_fasta_t * fd)
   fd->head = 0;
   fd->seq = 0;
 
+  pthread_mutex_lock(&of_mutex);
   if (fd->ofid != of_count-1)
   {
     of[fd->ofid] = of[of_count-1];
+    of[fd->ofid]->ofid = fd->ofid;
   }
+  of_count--;
+  pthread_mutex_unlock(&of_mutex);
 
   free(fd);
-  of_count--;
 }
 
-int salt_fasta_getnext(salt_fasta_t * fd, char ** head, long * head_len,
-                       char ** seq, long * seq_len, long * qno,
-                       long * qsize)
+void salt_fasta_close(salt_fasta_t * fd)
+{
+  fasta_warn_stripped(fd->stripped_count, fd->stripped);
+  fasta_free(fd);
+}
+
+/* grow the sequence buffer geometrically, so that reading a long record
+   costs amortized constant time per character */
+static void fasta_reserve(salt_fasta_t * fd, long len)
+{
+  if (len <= fd->seq_alloc)
+    return;
+
+  while (fd->seq_alloc < len)
+    fd->seq_alloc <<= 1;
+
+  fd->seq = (char *) xrealloc(fd->seq, (size_t)(fd->seq_alloc));
+}
+
+/* check a sequence character, returns 1 if it is to be kept */
+static inline int fasta_legal(salt_fasta_t * fd, char c)
 {
   char msg[200];
-  while (fd->line[0])
+
+  switch(chrstatus[(unsigned char)c])
     {
-      /* read header */
+    case 0:
+      /* character to be stripped */
+      fd->stripped_count++;
+      fd->stripped[(unsigned char)c]++;
+      return 0;
+
+    case 1:
+      /* legal character */
+      return 1;
 
-      if (fd->line[0] != '>')
-        fatal("Illegal header line in query fasta file");
+    case 2:
+      /* fatal character */
+      if (c>=32)
+        snprintf(msg, 200, "illegal character '%c' on line %ld in the query file", c, fd->lineno);
+      else
+        snprintf(msg, 200, "illegal unprintable character %#.2x (hexadecimal) on line %ld in the query file", c, fd->lineno);
+      fatal(msg);
+    }
 
-      long headerlen = xstrchrnul(fd->line+1, '\n') - (fd->line+1);
-      fd->head_len = headerlen;
+  /* silently stripped chars */
+  return 0;
+}
 
-      if (headerlen + 1 > fd->head_alloc)
-        {
-          fd->head_alloc = headerlen + 1;
-          fd->head = (char *) xrealloc(fd->head,
-                                             (size_t)(fd->head_alloc));
-        }
+/* read the header in the current line and move to the next line */
+static void fasta_read_header(salt_fasta_t * fd, long * qsize)
+{
+  if (fd->line[0] != '>')
+    fatal("Illegal header line in query fasta file");
 
-      memcpy(fd->head, fd->line + 1, (size_t)headerlen);
-      fd->head[headerlen] = 0;
+  long headerlen = xstrchrnul(fd->line+1, '\n') - (fd->line+1);
+  fd->head_len = headerlen;
 
-      /* read size/abundance annotation */
+  if (headerlen + 1 > fd->head_alloc)
+    {
+      fd->head_alloc = headerlen + 1;
+      fd->head = (char *) xrealloc(fd->head,
+                                         (size_t)(fd->head_alloc));
+    }
 
-      regmatch_t pmatch[4];
+  memcpy(fd->head, fd->line + 1, (size_t)headerlen);
+  fd->head[headerlen] = 0;
 
-      if (!regexec(&(fd->q_regexp), fd->head, 4, pmatch, 0))
-        {
-          unsigned long size = atol(fd->head + pmatch[2].rm_so);
-          if (size > 0)
-            * qsize = size;
-          else
-            fatal("Size annotation zero in query sequence");
-        }
+  /* read size/abundance annotation */
+
+  regmatch_t pmatch[4];
+
+  if (!regexec(&(fd->q_regexp), fd->head, 4, pmatch, 0))
+    {
+      unsigned long size = atol(fd->head + pmatch[2].rm_so);
+      if (size > 0)
+        * qsize = size;
       else
-        *qsize = 1;
+        fatal("Size annotation zero in query sequence");
+    }
+  else
+    *qsize = 1;
+
+  /* get next line */
+
+  fasta_nextline(fd);
+}
+
+int salt_fasta_getnext(salt_fasta_t * fd, char ** head, long * head_len,
+                       char ** seq, long * seq_len, long * qno,
+                       long * qsize)
+{
+  while (fd->line[0])
+    {
+      /* records starting at or after the end of the range belong to the
+         next chunk */
+
+      if (fd->range_end >= 0 && fd->linepos >= fd->range_end)
+        return 0;
 
-      /* get next line */
+      /* read header */
 
-      fd->line[0] = 0;
-      fgets(fd->line, LINEALLOC, fd->fp);
-      fd->lineno++;
+      fasta_read_header(fd, qsize);
 
       /* read sequence */
 
@@ -223,65 +300,22 @@ int salt_fasta_getnext(salt_fasta_t * fd, char ** head, long * head_len,
       while (fd->line[0] && (fd->line[0] != '>'))
         {
           char c;
-          char m;
           char * p = fd->line;
 
+          /* room for the whole line and the terminating zero */
+          fasta_reserve(fd, fd->seq_len + LINEALLOC);
+
           while((c = *p++))
-            {
-              m = chrstatus[(int)c];
-              switch(m)
-                {
-                case 0:
-                  /* character to be stripped */
-                  fd->stripped_count++;
-                  fd->stripped[(int)c]++;
-                  break;
-
-                case 1:
-                  /* legal character */
-                  if (fd->seq_len + 1 > fd->seq_alloc)
-                    {
-                      fd->seq_alloc += MEMCHUNK;
-                      fd->seq = (char *) xrealloc(fd->seq, (size_t)(fd->seq_alloc));
-                    }
-                  *(fd->seq + fd->seq_len) = c;
-                  fd->seq_len++;
-
-                  break;
-
-                case 2:
-                  /* fatal character */
-                  if (c>=32)
-                    snprintf(msg, 200, "illegal character '%c' on line %ld in the query file", c, fd->lineno);
-                  else
-                    snprintf(msg, 200, "illegal unprintable character %#.2x (hexadecimal) on line %ld in the query file", c, fd->lineno);
-                  fatal(msg);
-                  break;
-
-                case 3:
-                  /* silently stripped chars */
-                  break;
-
-                }
-            }
-
-          fd->line[0] = 0;
-          fgets(fd->line, LINEALLOC, fd->fp);
-          fd->lineno++;
+            if (fasta_legal(fd, c))
+              *(fd->seq + fd->seq_len++) = c;
+
+          fasta_nextline(fd);
         }
 
       /* add zero after sequence */
 
-      if (fd->seq_len + 1 > fd->seq_alloc)
-        {
-          fd->seq_alloc += MEMCHUNK;
-          fd->seq = (char *) xrealloc(fd->seq, (size_t)fd->seq_alloc);
-        }
       *(fd->seq + fd->seq_len) = 0;
 
-
-
-
       fd->no++;
       *head = fd->head;
       *seq = fd->seq;
@@ -295,4 +329,275 @@ int salt_fasta_getnext(salt_fasta_t * fd, char ** head, long * head_len,
   return 0;
 }
 
+/* skip stripped characters and return 1 if another sequence character of
+   the current record follows, leaving fd->winp pointing to it */
+static int fasta_window_peek(salt_fasta_t * fd)
+{
+  while (1)
+    {
+      char c = *(fd->winp);
+
+      if (!c)
+        {
+          fasta_nextline(fd);
+          fd->winp = fd->line;
+
+          if (!fd->line[0] || fd->line[0] == '>')
+            return 0;
+
+          continue;
+        }
+
+      if (chrstatus[(unsigned char)c] == 1)
+        return 1;
 
+      fasta_legal(fd, c);
+      fd->winp++;
+    }
+}
+
+/* iterate over the sequences in windows of at most window characters, where
+   consecutive windows of the same record share overlap characters. Only
+   one window is held in memory, so records of any length can be scanned.
+   offset is the position of the window in the record, and last is set on
+   the final window of each record. This function must not be mixed with
+   salt_fasta_getnext on the same file. */
+int salt_fasta_getwindow(salt_fasta_t * fd, long window, long overlap,
+                         char ** head, long * head_len,
+                         char ** seq, long * seq_len, long * offset,
+                         int * last, long * qno, long * qsize)
+{
+  if (overlap < 0 || overlap >= window)
+    fatal("Window overlap must be smaller than the window");
+
+  fasta_reserve(fd, window + 1);
+
+  if (!fd->win_inrecord)
+    {
+      if (!fd->line[0])
+        return 0;
+
+      if (fd->range_end >= 0 && fd->linepos >= fd->range_end)
+        return 0;
+
+      fasta_read_header(fd, &(fd->win_qsize));
+
+      fd->no++;
+      fd->win_inrecord = 1;
+      fd->win_offset = 0;
+      fd->seq_len = 0;
+      fd->winp = fd->line;
+
+      if (!fd->line[0] || fd->line[0] == '>')
+        fd->winp = fd->line + strlen(fd->line);
+    }
+  else
+    {
+      /* keep the overlap of the previous window */
+      memmove(fd->seq, fd->seq + fd->seq_len - overlap, (size_t)overlap);
+      fd->win_offset += fd->seq_len - overlap;
+      fd->seq_len = overlap;
+    }
+
+  /* fill the window */
+
+  int more = fd->line[0] && fd->line[0] != '>';
+
+  while (more && fd->seq_len < window && (more = fasta_window_peek(fd)))
+    fd->seq[fd->seq_len++] = *(fd->winp++);
+
+  if (more)
+    more = fasta_window_peek(fd);
+
+  fd->seq[fd->seq_len] = 0;
+
+  if (!more)
+    fd->win_inrecord = 0;
+
+  *head = fd->head;
+  *head_len = fd->head_len;
+  *seq = fd->seq;
+  *seq_len = fd->seq_len;
+  *offset = fd->win_offset;
+  *last = !more;
+  *qno = fd->no;
+  *qsize = fd->win_qsize;
+
+  return 1;
+}
+
+/* fill a caller-owned batch with the next records of the file until the
+   batch reaches its record or byte limit, and return the number of records
+   read (0 at the end of the file) */
+long salt_fasta_getbatch(salt_fasta_t * fd, salt_batch_t * batch)
+{
+  char * head;
+  char * seq;
+  long head_len;
+  long seq_len;
+  long qno;
+  long qsize;
+  long bases = 0;
+
+  SALT_STAGE_BEGIN;
+
+  salt_batch_reset(batch);
+  batch->first_qno = fd->no + 1;
+
+  while (!salt_batch_full(batch) &&
+         salt_fasta_getnext(fd, &head, &head_len,
+                            &seq, &seq_len, &qno, &qsize))
+  {
+    salt_batch_append(batch, head, head_len, seq, seq_len, NULL, qsize);
+    bases += seq_len;
+  }
+
+  SALT_STAGE_END(SALT_STAGE_PARSE);
+  SALT_STAGE_UNITS(SALT_STAGE_PARSE, bases);
+
+  return batch->count;
+}
+
+/* open a file for reading only the records whose header line starts in the
+   byte range [start,end). The reader resynchronizes on the first line
+   starting with '>' at or after start. Line numbers in error messages are
+   relative to the start of the range. */
+static salt_fasta_t * fasta_open_range(const char * filename,
+                                       long start,
+                                       long end)
+{
+  salt_fasta_t * fd = salt_fasta_open(filename);
+
+  fd->range_end = end;
+
+  if (start == 0)
+    return fd;
+
+  if (fseek(fd->fp, start-1, SEEK_SET))
+    fatal("Error: Unable to seek in query file (%s)", filename);
+
+  /* skip the rest of the line containing byte start-1 */
+  int c;
+  long pos = start-1;
+  while ((c = fgetc(fd->fp)) != EOF)
+  {
+    pos++;
+    if (c == '\n')
+      break;
+  }
+
+  /* skip lines until the next header, watching for line fragments */
+  fd->linepos = pos;
+  fd->line[0] = 0;
+  fgets(fd->line, LINEALLOC, fd->fp);
+  fd->lineno = 1;
+
+  int linestart = 1;
+  while (fd->line[0] && !(linestart && fd->line[0] == '>'))
+  {
+    long len = strlen(fd->line);
+    linestart = (fd->line[len-1] == '\n');
+    fasta_nextline(fd);
+  }
+
+  return fd;
+}
+
+typedef struct
+{
+  const char * filename;
+  long start;
+  long end;
+  salt_batch_t * batch;
+  long stripped_count;
+  long stripped[256];
+} fasta_chunk_t;
+
+static void * fasta_chunk_worker(void * arg)
+{
+  fasta_chunk_t * chunk = (fasta_chunk_t *) arg;
+  salt_fasta_t * fd = fasta_open_range(chunk->filename,
+                                       chunk->start,
+                                       chunk->end);
+
+  salt_fasta_getbatch(fd, chunk->batch);
+
+  chunk->stripped_count = fd->stripped_count;
+  memcpy(chunk->stripped, fd->stripped, sizeof(chunk->stripped));
+
+  fasta_free(fd);
+
+  return NULL;
+}
+
+/* parse a whole file with one thread per chunk of about filesize/chunks
+   bytes. Returns an array of chunks batches holding all records in file
+   order, with first_qno set as if the file had been read sequentially.
+   The caller destroys the batches and frees the array. Standard input
+   and other streams cannot be split and are read sequentially. */
+salt_batch_t ** salt_fasta_getbatch_parallel(const char * filename,
+                                             long chunks)
+{
+  salt_fasta_t * fd = salt_fasta_open(filename);
+  long filesize = salt_fasta_getfilesize(fd);
+
+  /* chunks may be empty, hence their number is not limited by the size */
+  if (chunks < 1)
+    chunks = 1;
+
+  /* streams can only be read sequentially, into the first batch */
+  if (filesize < 0 || !strcmp(filename, "-"))
+  {
+    salt_batch_t ** batches = (salt_batch_t **) xmalloc(chunks * sizeof(salt_batch_t *), 8);
+    for (long i = 0; i < chunks; ++i)
+      batches[i] = salt_batch_create(0, 0);
+
+    salt_fasta_getbatch(fd, batches[0]);
+    salt_fasta_close(fd);
+
+    return batches;
+  }
+
+  fasta_free(fd);
+
+  fasta_chunk_t * chunk = (fasta_chunk_t *) xmalloc(chunks * sizeof(fasta_chunk_t), 8);
+  pthread_t * thread = (pthread_t *) xmalloc(chunks * sizeof(pthread_t), 8);
+  salt_batch_t ** batches = (salt_batch_t **) xmalloc(chunks * sizeof(salt_batch_t *), 8);
+
+  for (long i = 0; i < chunks; ++i)
+  {
+    chunk[i].filename = filename;
+    chunk[i].start = filesize * i / chunks;
+    chunk[i].end = filesize * (i+1) / chunks;
+    chunk[i].batch = batches[i] = salt_batch_create(0, 0);
+
+    if (pthread_create(thread+i, NULL, fasta_chunk_worker, chunk+i))
+      fatal("Cannot create thread");
+  }
+
+  /* global record numbers are a prefix sum over the chunk counts */
+  long qno = 0;
+  long stripped_count = 0;
+  long stripped[256];
+  memset(stripped, 0, sizeof(stripped));
+
+  for (long i = 0; i < chunks; ++i)
+  {
+    if (pthread_join(thread[i], NULL))
+      fatal("Cannot join thread");
+
+    batches[i]->first_qno = qno;
+    qno += batches[i]->count;
+
+    stripped_count += chunk[i].stripped_count;
+    for (int j = 0; j < 256; ++j)
+      stripped[j] += chunk[i].stripped[j];
+  }
+
+  fasta_warn_stripped(stripped_count, stripped);
+
+  free(thread);
+  free(chunk);
+
+  return batches;
+}
@@ -30,6 +30,7 @@
 #include <getopt.h>
 #include <x86intrin.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdarg.h>
 #include <time.h>
 #include <limits.h>
@@ -44,6 +45,8 @@
 #include <sys/sysinfo.h>
 #endif
 
+#include "salt_api.h"
+
 /* platform specific */
 
 #ifdef _WIN32
@@ -61,6 +64,11 @@
 #define SALT_ALIGNMENT_SSE 16
 #define SALT_ALIGNMENT_AVX 32
 #define SALT_ALIGNMENT_MAX 32 // used whenever it is yet unclear which alignment is needed
+#define SALT_CACHELINE 64
+
+/* read lengths with SIMD kernels of their own, used when both sequences
+   have the length; X(L) is expanded for every length */
+#define SALT_FIXED_LENGTHS(X) X(150) X(250) X(300)
 
 #ifdef __APPLE__
 #define PROG_ARCH "macosx_x86_64"
@@ -106,9 +114,416 @@ typedef struct
 
   long ofid;
 
+  long linepos;
+  long range_end;
+
+  int win_inrecord;
+  char * winp;
+  long win_offset;
+  long win_qsize;
+
   regex_t q_regexp;
 } salt_fasta_t;
 
+typedef struct
+{
+  FILE * fp;
+
+  char * line;
+  long line_len;
+  long line_alloc;
+
+  long no;
+
+  char * head;
+  char * seq;
+  char * qual;
+
+  long head_len;
+  long seq_len;
+  long qual_len;
+
+  long head_alloc;
+  long seq_alloc;
+
+  long filesize;
+  long filepos;
+
+  long lineno;
+
+  long phred_offset;
+} salt_fastq_t;
+
+typedef struct
+{
+  long count;
+  long first_qno;
+
+  long max_records;
+  long max_bytes;
+
+  char * arena;
+  char * qual;
+  long arena_len;
+  long arena_alloc;
+
+  char * heads;
+  long heads_len;
+  long heads_alloc;
+
+  long * seq_offset;
+  long * seq_len;
+  long * head_offset;
+  long * head_len;
+  long * qsize;
+  long records_alloc;
+} salt_batch_t;
+
+#define SALT_STORE_HEADERS 1
+#define SALT_STORE_SIZES   2
+
+typedef struct
+{
+  int fd;
+  void * map;
+  size_t map_size;
+
+  long count;
+  long flags;
+
+  const unsigned char * data;
+  const uint64_t * seq_len;
+  const uint64_t * seq_off;
+  const uint64_t * exc_index;
+  const uint64_t * exc;
+  const uint64_t * sizes;
+  const uint64_t * head_index;
+  const char * heads;
+} salt_store_t;
+
+typedef struct
+{
+  char * name;
+  long len;
+  long offset;
+  long linebases;
+  long linewidth;
+} salt_fai_entry_t;
+
+typedef struct
+{
+  FILE * fp;
+
+  long count;
+  salt_fai_entry_t * entries;
+  long * sorted;
+
+  char * buf;
+  long buf_alloc;
+  char * raw;
+  long raw_alloc;
+} salt_fai_t;
+
+typedef struct
+{
+  pthread_mutex_t mutex;
+  long head;
+  long tail;
+} __attribute__((aligned(SALT_CACHELINE))) salt_deque_t;
+
+typedef struct
+{
+  long threads;
+  pthread_t * thread;
+  void * workers;
+
+  salt_deque_t * deque;
+  long * steals;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t start_cond;
+  pthread_cond_t done_cond;
+  long generation;
+  long running;
+  int quit;
+
+  long n;
+  long grain;
+  void (*fn)(long begin, long end, long tid, void * data);
+  void * data;
+} salt_pool_t;
+
+#define SALT_FORMAT_PAF 1
+#define SALT_FORMAT_GFA 2
+
+#define SALT_WRITER_BUFSIZE (1 << 20)
+
+typedef struct
+{
+  char * buf;
+  long len;
+  long alloc;
+  long records;
+} __attribute__((aligned(SALT_CACHELINE))) salt_writer_buffer_t;
+
+#define SALT_SCORE_MATRIX_SIZE 32
+
+typedef struct
+{
+  long score_long[SALT_SCORE_MATRIX_SIZE*SALT_SCORE_MATRIX_SIZE]
+    __attribute__((aligned(SALT_ALIGNMENT_MAX)));
+  WORD score_word[SALT_SCORE_MATRIX_SIZE*SALT_SCORE_MATRIX_SIZE]
+    __attribute__((aligned(SALT_ALIGNMENT_MAX)));
+  char score_char[SALT_SCORE_MATRIX_SIZE*SALT_SCORE_MATRIX_SIZE]
+    __attribute__((aligned(SALT_ALIGNMENT_MAX)));
+
+  long match;
+  long mismatch;
+  long maxabs;
+} salt_scoring_t;
+
+typedef struct
+{
+  const char * name;
+  long bits;
+  int avx2;
+  void (*align)(salt_scoring_t * scoring,
+                BYTE * dseq, BYTE * dend, BYTE * qseq, BYTE * qend,
+                long * psmscore, long * overlaplen, long * matchcase);
+
+  /* query profile kept over many database sequences (freed with free()),
+     and align using it; NULL for the kernels without a query profile */
+  void * (*profile)(salt_scoring_t * scoring, BYTE * qseq, BYTE * qend);
+  void (*align_profile)(const void * profile,
+                        BYTE * dseq, BYTE * dend, BYTE * qseq, BYTE * qend,
+                        long * psmscore, long * overlaplen, long * matchcase);
+} salt_kernel_t;
+
+typedef struct
+{
+  long d;
+  long q;
+  int strand;
+
+  long dlen;
+  long qlen;
+
+  long score;
+  long len;
+  long matchcase;
+  long matches;
+
+  long dstart;
+  long dend;
+  long qstart;
+  long qend;
+} salt_overlap_t;
+
+typedef struct
+{
+  long d;
+  int strand;
+  long diag;
+  long hits;
+} salt_candidate_t;
+
+/* flags of salt_arena_create */
+#define SALT_ARENA_HUGEPAGES 1
+#define SALT_ARENA_PREFAULT  2
+
+typedef struct salt_arena_block_s
+{
+  struct salt_arena_block_s * next;
+  size_t size;
+  size_t used;
+} __attribute__((aligned(SALT_CACHELINE))) salt_arena_block_t;
+
+typedef struct
+{
+  salt_arena_block_t * head;
+  size_t capacity;
+  int flags;
+} salt_arena_t;
+
+typedef struct
+{
+  salt_batch_t * batch;
+  long count;
+  int strands;
+
+  salt_arena_t * arena;
+  BYTE * fwd;
+  BYTE * rev;
+} salt_readset_t;
+
+typedef struct
+{
+  const salt_kernel_t * kernel;
+  salt_scoring_t * scoring;
+
+  long min_overlap;
+  double min_identity;
+  long band;
+
+  salt_pool_t * pool;
+  long grain;
+
+  long (*candidates)(void * data, long q, salt_candidate_t ** list);
+  void * candidates_data;
+
+  void (*report)(const salt_overlap_t * ovl, long tid, void * data);
+  void * report_data;
+} salt_allvsall_t;
+
+typedef struct
+{
+  FILE * fp;
+  int format;
+  salt_batch_t * batch;
+
+  long threads;
+  salt_writer_buffer_t * buffers;
+  salt_arena_t * arena;
+
+  pthread_mutex_t mutex;
+  long bytes;
+} salt_writer_t;
+
+#define SALT_MINIMIZER_MAX_W 256
+
+typedef struct
+{
+  uint64_t hash;
+  uint32_t read;
+  uint32_t pos_strand;
+} salt_minimizer_t;
+
+typedef struct
+{
+  salt_readset_t * reads;
+
+  long k;
+  long w;
+  long max_occ;
+  long min_hits;
+
+  long count;
+  salt_minimizer_t * entries;
+} salt_mindex_t;
+
+/* xoshiro256** generator state (gen_test.c) */
+
+typedef struct
+{
+  uint64_t s[4];
+} salt_rng_t;
+
+/* read simulator (gen_test.c) */
+
+#define SALT_SIM_FASTA 0
+#define SALT_SIM_FASTQ 1
+
+#define SALT_SIM_CHUNK 4096
+
+typedef struct
+{
+  long genome_len;
+  long reads;           /* reads, or pairs of reads if paired */
+  long min_len;
+  long max_len;
+
+  int paired;
+  long insert_mean;
+  long insert_sd;
+
+  /* error rates per genome base */
+  double sub_rate;
+  double ins_rate;
+  double del_rate;
+  double n_rate;
+
+  int format;
+  uint64_t seed;
+  long threads;
+} salt_sim_t;
+
+/* hardware performance counters (perf.c) */
+
+#define SALT_PERF_CYCLES       0
+#define SALT_PERF_INSTRUCTIONS 1
+#define SALT_PERF_L1D_MISSES   2
+#define SALT_PERF_LLC_LOADS    3
+#define SALT_PERF_LLC_MISSES   4
+#define SALT_PERF_BRANCH_MISSES 5
+#define SALT_PERF_EVENTS       6
+
+typedef struct
+{
+  int fd[SALT_PERF_EVENTS];
+  void * page[SALT_PERF_EVENTS];
+  unsigned int mask;
+} salt_perf_t;
+
+/* stages of the overlap kernels and of the all-vs-all pipeline, timed by
+   the hooks below (stage.c) */
+
+#define SALT_STAGE_PROFILE    0
+#define SALT_STAGE_DP         1
+#define SALT_STAGE_REDUCE     2
+#define SALT_STAGE_CANDIDATES 3
+#define SALT_STAGE_OUTPUT     4
+#define SALT_STAGE_PARSE      5
+#define SALT_STAGE_ENCODE     6
+#define SALT_STAGES           7
+
+/* latency histograms have one bucket per power of two of cycles */
+#define SALT_STAGE_BUCKETS    64
+
+/* modes of stage timing */
+#define SALT_STAGE_OFF    0
+#define SALT_STAGE_CYCLES 1
+#define SALT_STAGE_PERF   2
+
+typedef struct
+{
+  unsigned long long cycles[SALT_STAGES];
+  unsigned long long calls[SALT_STAGES];
+  unsigned long long events[SALT_STAGES][SALT_PERF_EVENTS];
+  unsigned long long units[SALT_STAGES];
+  unsigned long long hist[SALT_STAGES][SALT_STAGE_BUCKETS];
+  unsigned int perf_mask;
+  int registered;
+} salt_stage_t;
+
+extern int salt_stage_on;
+extern __thread salt_stage_t salt_stage_local;
+
+/* SALT_STAGE_BEGIN starts the clock and SALT_STAGE_END(s) charges the
+   cycles (and, in perf mode, the counter deltas) since the last hook to
+   stage s; both reduce to a test of salt_stage_on when timing is off */
+#define SALT_STAGE_BEGIN                                              \
+  unsigned long long salt_stage_tsc = salt_stage_on ? salt_stage_begin() : 0
+
+#define SALT_STAGE_END(s)                                             \
+  do                                                                  \
+  {                                                                   \
+    if (salt_stage_on)                                                \
+      salt_stage_tsc = salt_stage_end(s, salt_stage_tsc);             \
+  } while (0)
+
+/* SALT_STAGE_UNITS(s,n) adds n units of work (bases, cells or records)
+   to the throughput counter of stage s */
+#define SALT_STAGE_UNITS(s,n)                                         \
+  do                                                                  \
+  {                                                                   \
+    if (salt_stage_on)                                                \
+      salt_stage_local.units[s] += (unsigned long long)(n);           \
+  } while (0)
+
+#define SALT_BATCH_SEQ(b,i)  ((b)->arena + (b)->seq_offset[i])
+#define SALT_BATCH_QUAL(b,i) ((b)->qual + (b)->seq_offset[i])
+#define SALT_BATCH_HEAD(b,i) ((b)->heads + (b)->head_offset[i])
+
 
 /* common data */
 
@@ -130,12 +545,121 @@ SALT_EXPORT int salt_fasta_getnext(salt_fasta_t * fd, char ** head, long * head_
                                    char ** seq, long * seq_len, long * qno,
                                    long * qsize);
 
+SALT_EXPORT int salt_fasta_getwindow(salt_fasta_t * fd, long window,
+                                     long overlap, char ** head,
+                                     long * head_len, char ** seq,
+                                     long * seq_len, long * offset,
+                                     int * last, long * qno, long * qsize);
+
 SALT_EXPORT void salt_fasta_close(salt_fasta_t * fd);
 
 SALT_EXPORT long salt_fasta_getfilesize(salt_fasta_t * fd);
 
 SALT_EXPORT long salt_fasta_getfilepos(salt_fasta_t * fd);
 
+SALT_EXPORT long salt_fasta_getbatch(salt_fasta_t * fd, salt_batch_t * batch);
+
+SALT_EXPORT salt_batch_t ** salt_fasta_getbatch_parallel(const char * filename,
+                                                         long chunks);
+
+/* functions in fastq.c */
+
+SALT_EXPORT salt_fastq_t * salt_fastq_open(const char * filename);
+
+SALT_EXPORT void salt_fastq_set_phred_offset(salt_fastq_t * fd, long offset);
+
+SALT_EXPORT int salt_fastq_getnext(salt_fastq_t * fd, char ** head,
+                                   long * head_len, char ** seq,
+                                   long * seq_len, char ** qual, long * qno);
+
+SALT_EXPORT long salt_fastq_getbatch(salt_fastq_t * fd, salt_batch_t * batch);
+
+SALT_EXPORT void salt_fastq_close(salt_fastq_t * fd);
+
+SALT_EXPORT long salt_fastq_getfilesize(salt_fastq_t * fd);
+
+SALT_EXPORT long salt_fastq_getfilepos(salt_fastq_t * fd);
+
+/* functions in store.c */
+
+SALT_EXPORT void salt_store_build(const char * fasta_filename,
+                                  const char * store_filename,
+                                  long flags);
+
+SALT_EXPORT salt_store_t * salt_store_open(const char * filename);
+
+SALT_EXPORT void salt_store_close(salt_store_t * s);
+
+SALT_EXPORT long salt_store_count(salt_store_t * s);
+
+SALT_EXPORT long salt_store_seqlen(salt_store_t * s, long i);
+
+SALT_EXPORT long salt_store_size(salt_store_t * s, long i);
+
+SALT_EXPORT const char * salt_store_header(salt_store_t * s, long i);
+
+SALT_EXPORT void salt_store_getseq(salt_store_t * s, long i, char * out,
+                                   int encoded);
+
+/* functions in faidx.c */
+
+SALT_EXPORT void salt_fai_build(const char * filename);
+
+SALT_EXPORT salt_fai_t * salt_fai_load(const char * filename);
+
+SALT_EXPORT void salt_fai_close(salt_fai_t * fai);
+
+SALT_EXPORT long salt_fai_count(salt_fai_t * fai);
+
+SALT_EXPORT const char * salt_fai_name(salt_fai_t * fai, long i);
+
+SALT_EXPORT long salt_fai_length(salt_fai_t * fai, long i);
+
+SALT_EXPORT long salt_fai_lookup(salt_fai_t * fai, const char * name);
+
+SALT_EXPORT char * salt_fai_fetch(salt_fai_t * fai, long i, long start,
+                                  long end, long * len);
+
+/* functions in batch.c */
+
+SALT_EXPORT salt_batch_t * salt_batch_create(long max_records, long max_bytes);
+
+SALT_EXPORT void salt_batch_reset(salt_batch_t * batch);
+
+SALT_EXPORT void salt_batch_destroy(salt_batch_t * batch);
+
+SALT_EXPORT int salt_batch_full(salt_batch_t * batch);
+
+SALT_EXPORT void salt_batch_append(salt_batch_t * batch,
+                                   char * head, long head_len,
+                                   char * seq, long seq_len,
+                                   char * qual,
+                                   long qsize);
+
+/* functions in threadpool.c */
+
+SALT_EXPORT salt_pool_t * salt_pool_create(long threads);
+
+SALT_EXPORT void salt_pool_destroy(salt_pool_t * pool);
+
+SALT_EXPORT long salt_pool_threads(salt_pool_t * pool);
+
+SALT_EXPORT void salt_pool_run(salt_pool_t * pool, long n, long grain,
+                               void (*fn)(long begin, long end, long tid,
+                                          void * data),
+                               void * data);
+
+/* functions in writer.c */
+
+SALT_EXPORT salt_writer_t * salt_writer_open(const char * filename,
+                                             int format, long threads,
+                                             salt_batch_t * batch);
+
+SALT_EXPORT void salt_writer_report(const salt_overlap_t * ovl, long tid,
+                                    void * data);
+
+SALT_EXPORT long salt_writer_close(salt_writer_t * w);
+
 /* functions in util.c */
 
 SALT_EXPORT long gcd(long a, long b);
@@ -148,8 +672,21 @@ SALT_EXPORT void * xmalloc(size_t size, size_t alignment);
 
 SALT_EXPORT void * xrealloc(void * ptr, size_t size);
 
+SALT_EXPORT void * xrealloc_aligned(void * ptr, size_t used, size_t size,
+                                    size_t alignment);
+
 SALT_EXPORT void xfree (void* ptr);
 
+SALT_EXPORT FILE * xfopen_input(const char * filename, long * filesize);
+
+SALT_EXPORT void xfclose_input(FILE * fp);
+
+SALT_EXPORT void progress_init(const char * prompt, long size);
+
+SALT_EXPORT void progress_update(long progress);
+
+SALT_EXPORT void progress_done();
+
 SALT_EXPORT char * xstrchrnul(char *s, int c);
 
 SALT_EXPORT long getusec(void);
@@ -158,6 +695,184 @@ SALT_EXPORT void show_rusage();
 
 SALT_EXPORT void * xstrdup_aligned(char * s, size_t alignment);
 
+/* functions in overlap.c */
+
+SALT_EXPORT long salt_kernel_count();
+
+SALT_EXPORT const salt_kernel_t * salt_kernel_at(long i);
+
+SALT_EXPORT const salt_kernel_t * salt_kernel_get(const char * name);
+
+SALT_EXPORT int salt_kernel_fits(const salt_kernel_t * kernel,
+                                 salt_scoring_t * scoring,
+                                 long dlen, long qlen);
+
+SALT_EXPORT const salt_kernel_t * salt_kernel_profiled(const salt_kernel_t *
+                                                       kernel,
+                                                       salt_scoring_t * scoring,
+                                                       long qlen);
+
+SALT_EXPORT salt_scoring_t * salt_scoring_create(long match, long mismatch);
+
+SALT_EXPORT void salt_scoring_destroy(salt_scoring_t * s);
+
+SALT_EXPORT void salt_overlap_pair(const salt_kernel_t * kernel,
+                                   salt_scoring_t * scoring,
+                                   BYTE * dseq, long dlen,
+                                   BYTE * qseq, long qlen,
+                                   salt_overlap_t * ovl);
+
+SALT_EXPORT void salt_overlap_pair_profile(const salt_kernel_t * kernel,
+                                           const void * profile,
+                                           BYTE * dseq, long dlen,
+                                           BYTE * qseq, long qlen,
+                                           salt_overlap_t * ovl);
+
+SALT_EXPORT salt_readset_t * salt_readset_create(salt_batch_t * batch,
+                                                 int strands);
+
+SALT_EXPORT void salt_readset_destroy(salt_readset_t * reads);
+
+SALT_EXPORT BYTE * salt_readset_seq(salt_readset_t * reads, long i,
+                                    int strand);
+
+SALT_EXPORT long salt_readset_len(salt_readset_t * reads, long i);
+
+SALT_EXPORT void salt_overlap_pair_band(salt_scoring_t * scoring,
+                                        BYTE * dseq, long dlen,
+                                        BYTE * qseq, long qlen,
+                                        long diag, long band,
+                                        salt_overlap_t * ovl);
+
+SALT_EXPORT void salt_allvsall_init(salt_allvsall_t * opts);
+
+SALT_EXPORT long salt_allvsall(salt_readset_t * reads, salt_allvsall_t * opts);
+
+/* functions in minimizer.c */
+
+SALT_EXPORT salt_mindex_t * salt_minimizer_index(salt_readset_t * reads,
+                                                 long k, long w);
+
+SALT_EXPORT void salt_minimizer_index_destroy(salt_mindex_t * index);
+
+SALT_EXPORT long salt_minimizer_candidates(void * data, long q,
+                                           salt_candidate_t ** list);
+
+/* functions in arena.c */
+
+SALT_EXPORT salt_arena_t * salt_arena_create(size_t size, int flags);
+
+SALT_EXPORT void * salt_arena_grow(salt_arena_t * a, size_t size,
+                                   size_t alignment);
+
+SALT_EXPORT void salt_arena_merge(salt_arena_t * a);
+
+SALT_EXPORT void salt_arena_destroy(salt_arena_t * a);
+
+SALT_EXPORT size_t salt_arena_capacity(salt_arena_t * a);
+
+SALT_EXPORT void salt_arena_defaults(int flags);
+
+SALT_EXPORT int salt_arena_default_flags();
+
+SALT_EXPORT salt_arena_t * salt_kernel_scratch_create();
+
+extern __thread salt_arena_t * salt_kernel_scratch_local;
+
+/* alignment must be a power of two */
+static inline void * salt_arena_alloc(salt_arena_t * a, size_t size,
+                                      size_t alignment)
+{
+  salt_arena_block_t * b = a->head;
+  size_t offset = (b->used + alignment - 1) & ~(alignment - 1);
+
+  if (offset + size > b->size)
+    return salt_arena_grow(a, size, alignment);
+
+  b->used = offset + size;
+  return (char *) b + offset;
+}
+
+/* release all allocations, keeping the memory for reuse */
+static inline void salt_arena_reset(salt_arena_t * a)
+{
+  if (a->head->next)
+    salt_arena_merge(a);
+  a->head->used = sizeof(salt_arena_block_t);
+}
+
+/* scratch arena of the overlap kernels in the calling thread; every
+   kernel call resets it, so nothing else may allocate from it */
+static inline salt_arena_t * salt_kernel_scratch()
+{
+  if (!salt_kernel_scratch_local)
+    return salt_kernel_scratch_create();
+  return salt_kernel_scratch_local;
+}
+
+/* functions in stage.c */
+
+SALT_EXPORT void salt_stage_enable(int mode);
+
+SALT_EXPORT void salt_stage_reset();
+
+SALT_EXPORT void salt_stage_reset_all();
+
+SALT_EXPORT void salt_stage_get(salt_stage_t * stage);
+
+SALT_EXPORT void salt_stage_total(salt_stage_t * stage);
+
+SALT_EXPORT const char * salt_stage_name(int stage);
+
+SALT_EXPORT unsigned long long salt_stage_mark();
+
+SALT_EXPORT void salt_stage_perf(int stage);
+
+SALT_EXPORT void salt_stage_report(FILE * fp, const char * title,
+                                   const salt_stage_t * stage);
+
+SALT_EXPORT unsigned long long salt_stage_quantile(const salt_stage_t * stage,
+                                                   int s, double q);
+
+SALT_EXPORT void salt_stage_json(FILE * fp, const char * event,
+                                 const salt_stage_t * stage);
+
+SALT_EXPORT void salt_stage_dump(const char * event);
+
+SALT_EXPORT void salt_stage_watch(const char * filename);
+
+/* used by SALT_STAGE_BEGIN and SALT_STAGE_END */
+static inline unsigned long long salt_stage_begin()
+{
+  if (salt_stage_on == SALT_STAGE_PERF || !salt_stage_local.registered)
+    return salt_stage_mark();
+  return __rdtsc();
+}
+
+static inline unsigned long long salt_stage_end(int stage,
+                                                unsigned long long tsc)
+{
+  if (salt_stage_on == SALT_STAGE_PERF)
+    salt_stage_perf(stage);
+
+  unsigned long long now = __rdtsc();
+  unsigned long long delta = now - tsc;
+  salt_stage_local.cycles[stage] += delta;
+  salt_stage_local.calls[stage]++;
+  salt_stage_local.hist[stage][63 - __builtin_clzll(delta | 1)]++;
+  return now;
+}
+
+/* functions in perf.c */
+
+SALT_EXPORT salt_perf_t * salt_perf_open();
+
+SALT_EXPORT void salt_perf_read(salt_perf_t * perf, uint64_t * values);
+
+SALT_EXPORT void salt_perf_close(salt_perf_t * perf);
+
+SALT_EXPORT const char * salt_perf_name(int event);
+
 /* functions in overlap_nuc.c */
 
 SALT_EXPORT void salt_overlap_nuc4(char * dseq, char * dend,
@@ -167,18 +882,57 @@ SALT_EXPORT void salt_overlap_nuc4(char * dseq, char * dend,
                                    long * overlaplen,
                                    long * matchcase);
 
-/* functions in overlap_nuc4_avx2_8.c */
+/* functions in overlap_nuc4_band.c */
+
+SALT_EXPORT void salt_overlap_nuc4_band(BYTE * dseq,
+                                        BYTE * dend,
+                                        BYTE * qseq,
+                                        BYTE * qend,
+                                        long match,
+                                        long mismatch,
+                                        long diag,
+                                        long band,
+                                        long * psmscore,
+                                        long * overlaplen,
+                                        long * matchcase);
 
-SALT_EXPORT void salt_overlap_avx2_8(BYTE * dseq,
-                                     BYTE * dend,
-                                     BYTE * qseq,
-                                     BYTE * qend,
-                                     char * score_matrix,
-                                     long * psmscore,
-                                     long * overlaplen,
-                                     long * matchcase);
+/* functions in overlap_nuc4_simd.cc */
 
-/* functions in overlap_nuc4_sse_16bit.c */
+SALT_EXPORT void salt_overlap_nuc4_sse_8(BYTE * dseq,
+                                         BYTE * dend,
+                                         BYTE * qseq,
+                                         BYTE * qend,
+                                         char * score_matrix,
+                                         long * psmscore,
+                                         long * overlaplen,
+                                         long * matchcase);
+
+SALT_EXPORT void salt_overlap_nuc4_sse2_8(BYTE * dseq,
+                                          BYTE * dend,
+                                          BYTE * qseq,
+                                          BYTE * qend,
+                                          char * score_matrix,
+                                          long * psmscore,
+                                          long * overlaplen,
+                                          long * matchcase);
+
+SALT_EXPORT void salt_overlap_nuc4_sse_16(BYTE * dseq,
+                                          BYTE * dend,
+                                          BYTE * qseq,
+                                          BYTE * qend,
+                                          WORD * score_matrix,
+                                          long * psmscore,
+                                          long * overlaplen,
+                                          long * matchcase);
+
+SALT_EXPORT void salt_overlap_nuc4_avx2_8(BYTE * dseq,
+                                          BYTE * dend,
+                                          BYTE * qseq,
+                                          BYTE * qend,
+                                          char * score_matrix,
+                                          long * psmscore,
+                                          long * overlaplen,
+                                          long * matchcase);
 
 SALT_EXPORT void salt_overlap_nuc4_avx2_16(BYTE * dseq,
                                            BYTE * dend,
@@ -189,26 +943,198 @@ SALT_EXPORT void salt_overlap_nuc4_avx2_16(BYTE * dseq,
                                            long * overlaplen,
                                            long * matchcase);
 
-/* functions in overlap_nuc4_sse_8.c */
+SALT_EXPORT void salt_overlap_nuc4_avx2_lanes_8(BYTE * dseq,
+                                                BYTE * dend,
+                                                BYTE * qseq,
+                                                BYTE * qend,
+                                                char * score_matrix,
+                                                long * psmscore,
+                                                long * overlaplen,
+                                                long * matchcase);
 
-SALT_EXPORT void salt_overlap_nuc4_sse_8(BYTE * dseq,
-                                         BYTE * dend,
-                                         BYTE * qseq,
-                                         BYTE * qend,
-                                         char * score_matrix,
-                                         long * psmscore,
-                                         long * overlaplen,
-                                         long * matchcase);
+SALT_EXPORT void salt_overlap_nuc4_avx2_lanes_16(BYTE * dseq,
+                                                 BYTE * dend,
+                                                 BYTE * qseq,
+                                                 BYTE * qend,
+                                                 WORD * score_matrix,
+                                                 long * psmscore,
+                                                 long * overlaplen,
+                                                 long * matchcase);
 
-/* functions in overlap_nuc4_sse_16.c */
+SALT_EXPORT void salt_overlap_nuc4_avx2_diagonal_8(BYTE * dseq,
+                                                   BYTE * dend,
+                                                   BYTE * qseq,
+                                                   BYTE * qend,
+                                                   char * score_matrix,
+                                                   long * psmscore,
+                                                   long * overlaplen,
+                                                   long * matchcase);
 
-SALT_EXPORT void salt_overlap_nuc4_sse_16(BYTE * dseq, BYTE * dend,
-                                          BYTE * qseq, BYTE * qend,
-                                          WORD * score_matrix,
-                                          long * pmscore,
+SALT_EXPORT void salt_overlap_nuc4_avx2_diagonal_16(BYTE * dseq,
+                                                    BYTE * dend,
+                                                    BYTE * qseq,
+                                                    BYTE * qend,
+                                                    WORD * score_matrix,
+                                                    long * psmscore,
+                                                    long * overlaplen,
+                                                    long * matchcase);
+
+SALT_EXPORT void salt_overlap_nuc4_sse_32(BYTE * dseq,
+                                          BYTE * dend,
+                                          BYTE * qseq,
+                                          BYTE * qend,
+                                          char * score_matrix,
+                                          long * psmscore,
                                           long * overlaplen,
                                           long * matchcase);
 
+SALT_EXPORT void salt_overlap_nuc4_avx2_diagonal_32(BYTE * dseq,
+                                                    BYTE * dend,
+                                                    BYTE * qseq,
+                                                    BYTE * qend,
+                                                    char * score_matrix,
+                                                    long * psmscore,
+                                                    long * overlaplen,
+                                                    long * matchcase);
+
+SALT_EXPORT void * salt_overlap_nuc4_sse_8_profile(salt_scoring_t * scoring,
+                                                   BYTE * qseq,
+                                                   BYTE * qend);
+
+SALT_EXPORT void salt_overlap_nuc4_sse_8_align(const void * profile,
+                                               BYTE * dseq,
+                                               BYTE * dend,
+                                               BYTE * qseq,
+                                               BYTE * qend,
+                                               long * psmscore,
+                                               long * overlaplen,
+                                               long * matchcase);
+
+SALT_EXPORT void * salt_overlap_nuc4_sse2_8_profile(salt_scoring_t * scoring,
+                                                    BYTE * qseq,
+                                                    BYTE * qend);
+
+SALT_EXPORT void salt_overlap_nuc4_sse2_8_align(const void * profile,
+                                                BYTE * dseq,
+                                                BYTE * dend,
+                                                BYTE * qseq,
+                                                BYTE * qend,
+                                                long * psmscore,
+                                                long * overlaplen,
+                                                long * matchcase);
+
+SALT_EXPORT void * salt_overlap_nuc4_sse_16_profile(salt_scoring_t * scoring,
+                                                    BYTE * qseq,
+                                                    BYTE * qend);
+
+SALT_EXPORT void salt_overlap_nuc4_sse_16_align(const void * profile,
+                                                BYTE * dseq,
+                                                BYTE * dend,
+                                                BYTE * qseq,
+                                                BYTE * qend,
+                                                long * psmscore,
+                                                long * overlaplen,
+                                                long * matchcase);
+
+SALT_EXPORT void * salt_overlap_nuc4_avx2_8_profile(salt_scoring_t * scoring,
+                                                    BYTE * qseq,
+                                                    BYTE * qend);
+
+SALT_EXPORT void salt_overlap_nuc4_avx2_8_align(const void * profile,
+                                                BYTE * dseq,
+                                                BYTE * dend,
+                                                BYTE * qseq,
+                                                BYTE * qend,
+                                                long * psmscore,
+                                                long * overlaplen,
+                                                long * matchcase);
+
+SALT_EXPORT void * salt_overlap_nuc4_avx2_16_profile(salt_scoring_t * scoring,
+                                                     BYTE * qseq,
+                                                     BYTE * qend);
+
+SALT_EXPORT void salt_overlap_nuc4_avx2_16_align(const void * profile,
+                                                 BYTE * dseq,
+                                                 BYTE * dend,
+                                                 BYTE * qseq,
+                                                 BYTE * qend,
+                                                 long * psmscore,
+                                                 long * overlaplen,
+                                                 long * matchcase);
+
+SALT_EXPORT void * salt_overlap_nuc4_avx2_lanes_8_profile(salt_scoring_t * scoring,
+                                                          BYTE * qseq,
+                                                          BYTE * qend);
+
+SALT_EXPORT void salt_overlap_nuc4_avx2_lanes_8_align(const void * profile,
+                                                      BYTE * dseq,
+                                                      BYTE * dend,
+                                                      BYTE * qseq,
+                                                      BYTE * qend,
+                                                      long * psmscore,
+                                                      long * overlaplen,
+                                                      long * matchcase);
+
+SALT_EXPORT void * salt_overlap_nuc4_avx2_lanes_16_profile(salt_scoring_t * scoring,
+                                                           BYTE * qseq,
+                                                           BYTE * qend);
+
+SALT_EXPORT void salt_overlap_nuc4_avx2_lanes_16_align(const void * profile,
+                                                       BYTE * dseq,
+                                                       BYTE * dend,
+                                                       BYTE * qseq,
+                                                       BYTE * qend,
+                                                       long * psmscore,
+                                                       long * overlaplen,
+                                                       long * matchcase);
+
+SALT_EXPORT void * salt_overlap_nuc4_sse_32_profile(salt_scoring_t * scoring,
+                                                    BYTE * qseq,
+                                                    BYTE * qend);
+
+SALT_EXPORT void salt_overlap_nuc4_sse_32_align(const void * profile,
+                                                BYTE * dseq,
+                                                BYTE * dend,
+                                                BYTE * qseq,
+                                                BYTE * qend,
+                                                long * psmscore,
+                                                long * overlaplen,
+                                                long * matchcase);
+
+/* functions in gen_test.c */
+
+SALT_EXPORT void salt_rng_seed(salt_rng_t * rng, uint64_t seed);
+
+SALT_EXPORT uint64_t salt_rng_next(salt_rng_t * rng);
+
+SALT_EXPORT uint64_t salt_rng_range(salt_rng_t * rng, uint64_t n);
+
+SALT_EXPORT double salt_rng_double(salt_rng_t * rng);
+
+SALT_EXPORT void random_seed(uint64_t seed);
+
+SALT_EXPORT int random_int_range(int min, int max);
+
+SALT_EXPORT char random_char();
+
+SALT_EXPORT void generate_sequence(char * seq, int len);
+
+SALT_EXPORT void generate_pair(char * seq1, int len1, char * seq2, int len2,
+                               int overlap);
+
+SALT_EXPORT void generate_reads(int total_len, int reads_number,
+                                int reads_min_len, int reads_max_len,
+                                char * total_seq, char ** reads);
+
+SALT_EXPORT void induce_errors(char * seq, int len, float prob);
+
+SALT_EXPORT void salt_sim_init(salt_sim_t * sim);
+
+SALT_EXPORT char * salt_sim_genome(const salt_sim_t * sim);
+
+SALT_EXPORT long salt_sim_reads(const salt_sim_t * sim, const char * genome,
+                                FILE * out, FILE * mates);
+
 /* functions in popcount.c */
 
 SALT_EXPORT void pprint(__m128i x);
@@ -0,0 +1,109 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+/* public interface of libsalt.so (api.c); the only header a client of
+   the shared library needs, and the only symbols the library exports
+   (see libsalt.map) */
+
+#ifndef SALT_API_H
+#define SALT_API_H
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#define SALT_API __declspec(dllexport)
+#else
+#define SALT_API __attribute__((visibility("default")))
+#endif
+
+/* the major version changes with every incompatible change of the types
+   and functions below, and is the soname version */
+#define SALT_API_MAJOR   1
+#define SALT_API_MINOR   0
+#define SALT_API_VERSION ((SALT_API_MAJOR << 16) | SALT_API_MINOR)
+
+#define SALT_OK       0
+#define SALT_ERR_ARG -1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct salt_context_s salt_context_t;
+typedef struct salt_profile_s salt_profile_t;
+
+/* nucleotide sequences (ACGTU, anything else is read as A) */
+typedef struct
+{
+  const char * dseq;
+  int64_t dlen;
+  const char * qseq;
+  int64_t qlen;
+} salt_pair_t;
+
+/* best overlap of a pair */
+typedef struct
+{
+  int64_t score;
+  int64_t len;
+  int64_t matches;
+  int64_t dstart;
+  int64_t dend;
+  int64_t qstart;
+  int64_t qend;
+  int32_t matchcase;
+  int32_t reserved;
+} salt_result_t;
+
+SALT_API uint32_t salt_api_version(void);
+
+SALT_API salt_context_t * salt_context_create(uint32_t version,
+                                              const char * kernel,
+                                              int64_t threads);
+
+SALT_API void salt_context_destroy(salt_context_t * ctx);
+
+SALT_API const char * salt_context_kernel(const salt_context_t * ctx);
+
+SALT_API int salt_context_scoring(salt_context_t * ctx, int64_t match,
+                                  int64_t mismatch);
+
+SALT_API int salt_align_batch(salt_context_t * ctx,
+                              const salt_pair_t * pairs, int64_t count,
+                              salt_result_t * results);
+
+SALT_API salt_profile_t * salt_profile_create(salt_context_t * ctx,
+                                              const char * seq,
+                                              int64_t len);
+
+SALT_API void salt_profile_destroy(salt_profile_t * p);
+
+SALT_API int salt_align_profile(salt_context_t * ctx,
+                                const salt_profile_t * profile,
+                                const char * const * dseqs,
+                                const int64_t * dlens, int64_t count,
+                                salt_result_t * results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,458 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "salt.h"
+#include <signal.h>
+
+/*
+
+  Per-stage counters of the overlap kernels and the all-vs-all pipeline
+
+  Every kernel is split into three stages: building the query profile
+  (including the setup of its buffers), the dynamic programming loop over
+  the columns, and the reduction that picks the best overlap from the last
+  row and column. salt_allvsall adds the candidate generation and the
+  output of overlaps. With timing switched on, the hooks add the rdtsc
+  cycles spent in each stage to counters of the calling thread; in perf
+  mode they also add the deltas of the hardware counters of the thread
+  (perf.c). rdtsc is not serializing, so a few cycles may be charged to a
+  neighbouring stage; this only matters for very short sequences.
+
+  The counters of every thread that ran a hook are kept in a list, so
+  that salt_stage_total can sum them up after a parallel run. When a
+  thread exits, its counters are added to those of the retired threads
+  and its perf counters are closed.
+
+  Besides the totals, every stage keeps a latency histogram with one
+  bucket per power of two of rdtsc cycles, and a throughput counter of
+  the units of work it processed: bases for parse and encode, query bases
+  for profile, matrix cells for dp, candidates and records for the
+  pipeline. The quantiles derived from a histogram are the upper bounds
+  of their buckets, i.e. within a factor of two.
+
+  All counters are plain per-thread variables updated without locks or
+  atomics. They are summed up at exit or, with salt_stage_watch, whenever
+  the process receives SIGUSR1, and written as one line of JSON to a
+  file. A dump during a run reads the counters of running threads, so the
+  calls in flight may be missing and a histogram may be a few calls ahead
+  of the totals.
+
+  Timing is off by default and then costs one test per hook.
+
+*/
+
+int salt_stage_on = SALT_STAGE_OFF;
+__thread salt_stage_t salt_stage_local;
+
+typedef struct stage_thread_s
+{
+  salt_stage_t * stage;
+  salt_perf_t * perf;
+  int perf_tried;
+  uint64_t last[SALT_PERF_EVENTS];
+  struct stage_thread_s * next;
+} stage_thread_t;
+
+static __thread stage_thread_t * self = NULL;
+
+static pthread_mutex_t stage_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t stage_once = PTHREAD_ONCE_INIT;
+static pthread_key_t stage_key;
+static stage_thread_t * stage_threads = NULL;
+static salt_stage_t stage_retired;
+static int perf_warned = 0;
+
+static const char * stage_names[SALT_STAGES] =
+  { "profile", "dp", "reduce", "candidates", "output", "parse", "encode" };
+
+/* unit of the throughput counter of each stage, NULL for none */
+static const char * stage_units[SALT_STAGES] =
+  { "bases", "cells", NULL, "candidates", "records", "bases", "bases" };
+
+/* clock at the first call of salt_stage_enable, to estimate the rdtsc
+   frequency */
+static unsigned long long start_tsc = 0;
+static long start_usec = 0;
+
+static char * watch_filename = NULL;
+static pthread_mutex_t watch_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void stage_add(salt_stage_t * sum, const salt_stage_t * s)
+{
+  for (long i = 0; i < SALT_STAGES; ++i)
+  {
+    sum->cycles[i] += s->cycles[i];
+    sum->calls[i] += s->calls[i];
+    for (long e = 0; e < SALT_PERF_EVENTS; ++e)
+      sum->events[i][e] += s->events[i][e];
+    sum->units[i] += s->units[i];
+    for (long b = 0; b < SALT_STAGE_BUCKETS; ++b)
+      sum->hist[i][b] += s->hist[i][b];
+  }
+  sum->perf_mask |= s->perf_mask;
+}
+
+/* called when a registered thread exits */
+static void stage_exit(void * data)
+{
+  stage_thread_t * t = (stage_thread_t *) data;
+
+  pthread_mutex_lock(&stage_mutex);
+  stage_add(&stage_retired, t->stage);
+  for (stage_thread_t ** p = &stage_threads; *p; p = &(*p)->next)
+    if (*p == t)
+    {
+      *p = t->next;
+      break;
+    }
+  pthread_mutex_unlock(&stage_mutex);
+
+  if (t->perf)
+    salt_perf_close(t->perf);
+  free(t);
+}
+
+static void stage_key_create()
+{
+  pthread_key_create(&stage_key, stage_exit);
+}
+
+static stage_thread_t * stage_self()
+{
+  if (self)
+    return self;
+
+  pthread_once(&stage_once, stage_key_create);
+
+  self = (stage_thread_t *) xmalloc(sizeof(stage_thread_t), 8);
+  memset(self, 0, sizeof(stage_thread_t));
+  self->stage = &salt_stage_local;
+
+  pthread_mutex_lock(&stage_mutex);
+  self->next = stage_threads;
+  stage_threads = self;
+  pthread_mutex_unlock(&stage_mutex);
+
+  pthread_setspecific(stage_key, self);
+  salt_stage_local.registered = 1;
+
+  return self;
+}
+
+/* start of a kernel: register the thread, and in perf mode read its
+   counters */
+unsigned long long salt_stage_mark()
+{
+  stage_thread_t * t = stage_self();
+
+  if (salt_stage_on == SALT_STAGE_PERF)
+  {
+    if (!t->perf_tried)
+    {
+      t->perf_tried = 1;
+      t->perf = salt_perf_open();
+
+      if (!t->perf && !__sync_lock_test_and_set(&perf_warned, 1))
+        fprintf(stderr, "Warning: hardware performance counters are not "
+                "available, only cycles are counted\n");
+    }
+
+    if (t->perf)
+    {
+      salt_perf_read(t->perf, t->last);
+      salt_stage_local.perf_mask = t->perf->mask;
+    }
+  }
+
+  return __rdtsc();
+}
+
+/* in perf mode, charge the counter deltas since the last hook to stage */
+void salt_stage_perf(int stage)
+{
+  stage_thread_t * t = self;
+  uint64_t now[SALT_PERF_EVENTS];
+
+  if (!t || !t->perf)
+    return;
+
+  salt_perf_read(t->perf, now);
+
+  for (long e = 0; e < SALT_PERF_EVENTS; ++e)
+  {
+    salt_stage_local.events[stage][e] += now[e] - t->last[e];
+    t->last[e] = now[e];
+  }
+}
+
+/* one of SALT_STAGE_OFF, SALT_STAGE_CYCLES or SALT_STAGE_PERF */
+void salt_stage_enable(int mode)
+{
+  if (mode != SALT_STAGE_OFF && !start_usec)
+  {
+    start_tsc = __rdtsc();
+    start_usec = getusec();
+  }
+
+  salt_stage_on = mode;
+}
+
+/* clear the counters of the calling thread */
+void salt_stage_reset()
+{
+  int registered = salt_stage_local.registered;
+
+  memset(&salt_stage_local, 0, sizeof(salt_stage_t));
+  salt_stage_local.registered = registered;
+}
+
+/* clear the counters of all threads; no kernel may run meanwhile */
+void salt_stage_reset_all()
+{
+  pthread_mutex_lock(&stage_mutex);
+  for (stage_thread_t * t = stage_threads; t; t = t->next)
+  {
+    int registered = t->stage->registered;
+    memset(t->stage, 0, sizeof(salt_stage_t));
+    t->stage->registered = registered;
+  }
+  memset(&stage_retired, 0, sizeof(salt_stage_t));
+  pthread_mutex_unlock(&stage_mutex);
+
+  salt_stage_reset();
+}
+
+/* copy the counters of the calling thread */
+void salt_stage_get(salt_stage_t * stage)
+{
+  *stage = salt_stage_local;
+}
+
+/* sum of the counters of all threads; no kernel may run meanwhile */
+void salt_stage_total(salt_stage_t * stage)
+{
+  memset(stage, 0, sizeof(salt_stage_t));
+
+  pthread_mutex_lock(&stage_mutex);
+  stage_add(stage, &stage_retired);
+  for (stage_thread_t * t = stage_threads; t; t = t->next)
+    stage_add(stage, t->stage);
+  pthread_mutex_unlock(&stage_mutex);
+
+  /* the calling thread may not have run a kernel yet */
+  if (!salt_stage_local.registered)
+    stage_add(stage, &salt_stage_local);
+}
+
+const char * salt_stage_name(int stage)
+{
+  if (stage < 0 || stage >= SALT_STAGES)
+    return NULL;
+
+  return stage_names[stage];
+}
+
+static void report_event(FILE * fp, const salt_stage_t * s, long stage,
+                         long event, double calls)
+{
+  if (s->perf_mask & (1u << event))
+    fprintf(fp, " %12.1f", s->events[stage][event] / calls);
+  else
+    fprintf(fp, " %12s", "-");
+}
+
+/* table of the stages that ran, with cycles and counters per call */
+void salt_stage_report(FILE * fp, const char * title,
+                       const salt_stage_t * stage)
+{
+  fprintf(fp, "%s\n", title);
+  fprintf(fp, "%-10s %10s %12s", "stage", "calls", "rdtsc/call");
+  for (long e = 0; e < SALT_PERF_EVENTS; ++e)
+    fprintf(fp, " %12s", salt_perf_name(e));
+  fprintf(fp, " %6s\n", "IPC");
+
+  for (long i = 0; i < SALT_STAGES; ++i)
+  {
+    double calls = (double) stage->calls[i];
+
+    if (!stage->calls[i])
+      continue;
+
+    fprintf(fp, "%-10s %10llu %12.1f", stage_names[i], stage->calls[i],
+            stage->cycles[i] / calls);
+
+    for (long e = 0; e < SALT_PERF_EVENTS; ++e)
+      report_event(fp, stage, i, e, calls);
+
+    unsigned int ipc = (1u << SALT_PERF_CYCLES) | (1u << SALT_PERF_INSTRUCTIONS);
+    if ((stage->perf_mask & ipc) == ipc && stage->events[i][SALT_PERF_CYCLES])
+      fprintf(fp, " %6.2f\n", (double) stage->events[i][SALT_PERF_INSTRUCTIONS] /
+              stage->events[i][SALT_PERF_CYCLES]);
+    else
+      fprintf(fp, " %6s\n", "-");
+  }
+}
+
+/* number of cycles below which a fraction q of the calls of stage s
+   completed, rounded up to the next power of two */
+unsigned long long salt_stage_quantile(const salt_stage_t * stage, int s,
+                                       double q)
+{
+  unsigned long long rank = (unsigned long long)(q * stage->calls[s]);
+  unsigned long long seen = 0;
+
+  if (!stage->calls[s])
+    return 0;
+
+  if (rank < 1)
+    rank = 1;
+
+  for (long b = 0; b < SALT_STAGE_BUCKETS - 1; ++b)
+  {
+    seen += stage->hist[s][b];
+    if (seen >= rank)
+      return 1ull << (b+1);
+  }
+
+  return ~0ull;
+}
+
+/* rdtsc cycles per second since timing was enabled, 0 if unknown */
+static double stage_tsc_hz()
+{
+  long usec = getusec() - start_usec;
+
+  if (!start_usec || usec < 1000)
+    return 0;
+
+  return (__rdtsc() - start_tsc) / (usec / 1e6);
+}
+
+/* the counters as one line of JSON, tagged with event (e.g. "exit") */
+void salt_stage_json(FILE * fp, const char * event,
+                     const salt_stage_t * stage)
+{
+  fprintf(fp, "{\"event\": \"%s\", \"time_us\": %ld, \"tsc_hz\": %.0f, "
+          "\"stages\": {", event, getusec(), stage_tsc_hz());
+
+  int first = 1;
+  for (long i = 0; i < SALT_STAGES; ++i)
+  {
+    if (!stage->calls[i])
+      continue;
+
+    fprintf(fp, "%s\"%s\": {\"calls\": %llu, \"cycles\": %llu",
+            first ? "" : ", ", stage_names[i], stage->calls[i],
+            stage->cycles[i]);
+    first = 0;
+
+    if (stage_units[i])
+      fprintf(fp, ", \"%s\": %llu", stage_units[i], stage->units[i]);
+
+    fprintf(fp, ", \"p50_cycles\": %llu, \"p90_cycles\": %llu, "
+            "\"p99_cycles\": %llu, \"max_cycles\": %llu",
+            salt_stage_quantile(stage, i, 0.5),
+            salt_stage_quantile(stage, i, 0.9),
+            salt_stage_quantile(stage, i, 0.99),
+            salt_stage_quantile(stage, i, 1.0));
+
+    for (long e = 0; e < SALT_PERF_EVENTS; ++e)
+      if (stage->perf_mask & (1u << e))
+        fprintf(fp, ", \"%s\": %llu", salt_perf_name(e),
+                stage->events[i][e]);
+
+    /* buckets as [lower bound in cycles, calls], empty ones left out */
+    fprintf(fp, ", \"histogram\": [");
+    int bfirst = 1;
+    for (long b = 0; b < SALT_STAGE_BUCKETS; ++b)
+    {
+      if (!stage->hist[i][b])
+        continue;
+      fprintf(fp, "%s[%llu, %llu]", bfirst ? "" : ", ",
+              b ? 1ull << b : 0ull, stage->hist[i][b]);
+      bfirst = 0;
+    }
+    fprintf(fp, "]}");
+  }
+
+  fprintf(fp, "}}\n");
+}
+
+/* append the sum of the counters of all threads to the file given to
+   salt_stage_watch */
+void salt_stage_dump(const char * event)
+{
+  salt_stage_t * stage;
+
+  if (!watch_filename)
+    return;
+
+  /* too large for the stack of the watcher thread */
+  stage = (salt_stage_t *) xmalloc(sizeof(salt_stage_t), 8);
+  salt_stage_total(stage);
+
+  pthread_mutex_lock(&watch_mutex);
+  FILE * fp = fopen(watch_filename, "a");
+  if (fp)
+  {
+    salt_stage_json(fp, event, stage);
+    fclose(fp);
+  }
+  else
+    fprintf(stderr, "Warning: unable to write statistics to %s\n",
+            watch_filename);
+  pthread_mutex_unlock(&watch_mutex);
+
+  free(stage);
+}
+
+static void * watch_thread(void * data)
+{
+  sigset_t * set = (sigset_t *) data;
+  int sig;
+
+  while (!sigwait(set, &sig))
+    salt_stage_dump("signal");
+
+  return NULL;
+}
+
+/* dump the counters to filename whenever the process receives SIGUSR1.
+   Must be called before any other thread is started, as they inherit the
+   blocked signal mask. */
+void salt_stage_watch(const char * filename)
+{
+  static sigset_t set;
+  pthread_t thread;
+
+  watch_filename = xstrdup_aligned((char *)filename, 8);
+
+  sigemptyset(&set);
+  sigaddset(&set, SIGUSR1);
+  if (pthread_sigmask(SIG_BLOCK, &set, NULL))
+    fatal("Unable to block SIGUSR1");
+
+  if (pthread_create(&thread, NULL, watch_thread, &set))
+    fatal("Unable to create the statistics thread");
+  pthread_detach(thread);
+}
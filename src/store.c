@@ -0,0 +1,366 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "salt.h"
+#include <sys/mman.h>
+
+/*
+
+  Pre-encoded binary read store
+
+  A store is built once from a fasta file and then mapped into memory, so
+  that reads can be accessed by their index without parsing. Sequences are
+  packed with 2 bits per nucleotide (A=0, C=1, G=2, T/U=3, the first
+  nucleotide in the lowest bits) and every sequence starts at a byte
+  boundary. Symbols other than ACGT are stored as runs in an exception list
+  and are restored when decoding to text; lower case is not preserved.
+
+  layout (all fields 64-bit, native byte order)
+
+  header:     magic, version, count, flags, data offset, table offset,
+              number of exceptions, size of the header blob
+  data:       packed sequences
+  tables:     sequence lengths[count]
+              packed sequence offsets[count]
+              first exception of each sequence[count+1]
+              exceptions[2*number of exceptions] (position, run << 8 | chr)
+              sizes[count]                   (SALT_STORE_SIZES)
+              header offsets[count+1]        (SALT_STORE_HEADERS)
+              headers, zero terminated       (SALT_STORE_HEADERS)
+
+*/
+
+#define STORE_MAGIC   0x31305352544c4153UL  /* "SALTRS01" */
+#define STORE_VERSION 1
+#define STORE_HEADER  8
+
+static char decode_text[256][4];
+static char decode_code[256][4];
+static pthread_once_t decode_once = PTHREAD_ONCE_INIT;
+
+static void store_decode_init()
+{
+  static const char acgt[4] = { 'A', 'C', 'G', 'T' };
+
+  for (int i = 0; i < 256; ++i)
+    for (int j = 0; j < 4; ++j)
+    {
+      decode_code[i][j] = (i >> (2*j)) & 3;
+      decode_text[i][j] = acgt[(i >> (2*j)) & 3];
+    }
+}
+
+static void * grow(void * ptr, long * alloc, long needed, long elem)
+{
+  if (needed <= *alloc)
+    return ptr;
+
+  while (*alloc < needed)
+    *alloc = *alloc ? 2 * *alloc : 1024;
+
+  return xrealloc(ptr, (size_t)(*alloc * elem));
+}
+
+static void store_write(FILE * fp, const void * ptr, size_t size)
+{
+  if (size && fwrite(ptr, 1, size, fp) != size)
+    fatal("Error: Unable to write to read store");
+}
+
+void salt_store_build(const char * fasta_filename,
+                      const char * store_filename,
+                      long flags)
+{
+  char * head;
+  long head_len;
+  char * seq;
+  long seq_len;
+  long qno;
+  long qsize;
+
+  uint64_t * lens = NULL;
+  uint64_t * offs = NULL;
+  uint64_t * excidx = NULL;
+  uint64_t * exc = NULL;
+  uint64_t * sizes = NULL;
+  uint64_t * headidx = NULL;
+  char * heads = NULL;
+  unsigned char * packed = NULL;
+
+  long count = 0, lens_alloc = 0, offs_alloc = 0;
+  long excidx_alloc = 0, headidx_alloc = 0;
+  long exc_count = 0, exc_alloc = 0;
+  long sizes_alloc = 0, heads_len = 0, heads_alloc = 0;
+  long packed_alloc = 0;
+  uint64_t data_len = 0;
+
+  FILE * fp = fopen(store_filename, "w");
+  if (!fp)
+    fatal("Error: Unable to open read store for writing (%s)", store_filename);
+
+  /* placeholder for the header */
+  uint64_t header[STORE_HEADER];
+  memset(header, 0, sizeof(header));
+  store_write(fp, header, sizeof(header));
+
+  salt_fasta_t * fd = salt_fasta_open(fasta_filename);
+
+  while (salt_fasta_getnext(fd, &head, &head_len,
+                            &seq, &seq_len, &qno, &qsize))
+  {
+    lens = (uint64_t *) grow(lens, &lens_alloc, count+1, sizeof(uint64_t));
+    offs = (uint64_t *) grow(offs, &offs_alloc, count+1, sizeof(uint64_t));
+    excidx = (uint64_t *) grow(excidx, &excidx_alloc, count+1, sizeof(uint64_t));
+
+    lens[count] = seq_len;
+    offs[count] = data_len;
+    excidx[count] = exc_count;
+
+    /* pack the sequence and collect the runs of other symbols */
+    long packed_len = (seq_len + 3) / 4;
+    packed = (unsigned char *) grow(packed, &packed_alloc, packed_len, 1);
+    memset(packed, 0, (size_t)packed_len);
+
+    for (long i = 0; i < seq_len; ++i)
+    {
+      int c = toupper((unsigned char)seq[i]);
+      packed[i >> 2] |= chrmap_2bit[c] << (2*(i & 3));
+
+      if (c != 'A' && c != 'C' && c != 'G' && c != 'T')
+      {
+        if (exc_count > (long)excidx[count] &&
+            (long)(exc[2*exc_count-2] + (exc[2*exc_count-1] >> 8)) == i &&
+            (int)(exc[2*exc_count-1] & 0xff) == c)
+        {
+          /* extend the current run */
+          exc[2*exc_count-1] += 1 << 8;
+        }
+        else
+        {
+          exc = (uint64_t *) grow(exc, &exc_alloc, 2*exc_count+2, sizeof(uint64_t));
+          exc[2*exc_count] = i;
+          exc[2*exc_count+1] = (1 << 8) | c;
+          exc_count++;
+        }
+      }
+    }
+
+    store_write(fp, packed, (size_t)packed_len);
+    data_len += packed_len;
+
+    if (flags & SALT_STORE_SIZES)
+    {
+      sizes = (uint64_t *) grow(sizes, &sizes_alloc, count+1, sizeof(uint64_t));
+      sizes[count] = qsize;
+    }
+
+    if (flags & SALT_STORE_HEADERS)
+    {
+      headidx = (uint64_t *) grow(headidx, &headidx_alloc, count+1, sizeof(uint64_t));
+      headidx[count] = heads_len;
+      heads = (char *) grow(heads, &heads_alloc, heads_len + head_len + 1, 1);
+      memcpy(heads + heads_len, head, (size_t)head_len + 1);
+      heads_len += head_len + 1;
+    }
+
+    count++;
+  }
+
+  salt_fasta_close(fd);
+
+  /* terminate the index tables */
+  excidx = (uint64_t *) grow(excidx, &excidx_alloc, count+1, sizeof(uint64_t));
+  excidx[count] = exc_count;
+  if (flags & SALT_STORE_HEADERS)
+  {
+    headidx = (uint64_t *) grow(headidx, &headidx_alloc, count+1, sizeof(uint64_t));
+    headidx[count] = heads_len;
+  }
+
+  /* tables start 8-byte aligned */
+  uint64_t zero = 0;
+  long pad = roundup(data_len, 8) - data_len;
+  store_write(fp, &zero, (size_t)pad);
+
+  store_write(fp, lens, count * sizeof(uint64_t));
+  store_write(fp, offs, count * sizeof(uint64_t));
+  store_write(fp, excidx, (count+1) * sizeof(uint64_t));
+  store_write(fp, exc, 2 * exc_count * sizeof(uint64_t));
+  if (flags & SALT_STORE_SIZES)
+    store_write(fp, sizes, count * sizeof(uint64_t));
+  if (flags & SALT_STORE_HEADERS)
+  {
+    store_write(fp, headidx, (count+1) * sizeof(uint64_t));
+    store_write(fp, heads, (size_t)heads_len);
+  }
+
+  header[0] = STORE_MAGIC;
+  header[1] = STORE_VERSION;
+  header[2] = count;
+  header[3] = flags;
+  header[4] = sizeof(header);
+  header[5] = sizeof(header) + data_len + pad;
+  header[6] = exc_count;
+  header[7] = heads_len;
+
+  if (fseek(fp, 0, SEEK_SET))
+    fatal("Error: Unable to seek in read store (%s)", store_filename);
+  store_write(fp, header, sizeof(header));
+
+  if (fclose(fp))
+    fatal("Error: Unable to write to read store (%s)", store_filename);
+
+  free(lens);
+  free(offs);
+  free(excidx);
+  free(exc);
+  free(sizes);
+  free(headidx);
+  free(heads);
+  free(packed);
+}
+
+salt_store_t * salt_store_open(const char * filename)
+{
+  struct stat st;
+
+  /* stores may be opened by several threads at once */
+  pthread_once(&decode_once, store_decode_init);
+
+  salt_store_t * s = (salt_store_t *) xmalloc(sizeof(salt_store_t), 8);
+
+  s->fd = open(filename, O_RDONLY);
+  if (s->fd < 0)
+    fatal("Error: Unable to open read store (%s)", filename);
+
+  if (fstat(s->fd, &st))
+    fatal("Error: Unable to stat read store (%s)", filename);
+
+  s->map_size = st.st_size;
+  if (s->map_size < STORE_HEADER * sizeof(uint64_t))
+    fatal("Error: Not a salt read store (%s)", filename);
+
+  s->map = mmap(NULL, s->map_size, PROT_READ, MAP_PRIVATE, s->fd, 0);
+  if (s->map == MAP_FAILED)
+    fatal("Error: Unable to map read store (%s)", filename);
+
+  /* access by read index is mostly random */
+  posix_madvise(s->map, s->map_size, POSIX_MADV_RANDOM);
+
+  const uint64_t * header = (const uint64_t *) s->map;
+
+  if (header[0] != STORE_MAGIC)
+    fatal("Error: Not a salt read store (%s)", filename);
+  if (header[1] != STORE_VERSION)
+    fatal("Error: Unsupported read store version %lu (%s)",
+          (unsigned long)header[1], filename);
+
+  s->count = header[2];
+  s->flags = header[3];
+
+  const char * base = (const char *) s->map;
+  s->data = (const unsigned char *)(base + header[4]);
+
+  const uint64_t * t = (const uint64_t *)(base + header[5]);
+  s->seq_len = t;       t += s->count;
+  s->seq_off = t;       t += s->count;
+  s->exc_index = t;     t += s->count + 1;
+  s->exc = t;           t += 2 * header[6];
+
+  s->sizes = NULL;
+  if (s->flags & SALT_STORE_SIZES)
+  {
+    s->sizes = t;
+    t += s->count;
+  }
+
+  s->head_index = NULL;
+  s->heads = NULL;
+  if (s->flags & SALT_STORE_HEADERS)
+  {
+    s->head_index = t;
+    t += s->count + 1;
+    s->heads = (const char *) t;
+    t = (const uint64_t *)(s->heads + header[7]);
+  }
+
+  if ((const char *)t > base + s->map_size)
+    fatal("Error: Truncated read store (%s)", filename);
+
+  return s;
+}
+
+void salt_store_close(salt_store_t * s)
+{
+  munmap(s->map, s->map_size);
+  close(s->fd);
+  free(s);
+}
+
+long salt_store_count(salt_store_t * s)
+{
+  return s->count;
+}
+
+long salt_store_seqlen(salt_store_t * s, long i)
+{
+  return (long)s->seq_len[i];
+}
+
+long salt_store_size(salt_store_t * s, long i)
+{
+  return s->sizes ? (long)s->sizes[i] : 1;
+}
+
+const char * salt_store_header(salt_store_t * s, long i)
+{
+  return s->heads ? s->heads + s->head_index[i] : NULL;
+}
+
+/* decode read i into out, which must hold roundup(len+1, alignment) bytes.
+   If encoded is set, the 2-bit codes expected by the kernels are written
+   (other symbols become 0, as with chrmap_2bit), otherwise the text with
+   the other symbols restored. The sequence is followed by zeros up to the
+   next multiple of SALT_ALIGNMENT_MAX. */
+void salt_store_getseq(salt_store_t * s, long i, char * out, int encoded)
+{
+  long len = (long)s->seq_len[i];
+  const unsigned char * p = s->data + s->seq_off[i];
+  char (*table)[4] = encoded ? decode_code : decode_text;
+
+  long j;
+  for (j = 0; j + 4 <= len; j += 4)
+    memcpy(out + j, table[*p++], 4);
+  for (long k = 0; j < len; ++j, ++k)
+    out[j] = table[*p][k];
+
+  if (!encoded)
+  {
+    for (uint64_t e = s->exc_index[i]; e < s->exc_index[i+1]; ++e)
+      memset(out + s->exc[2*e],
+             (int)(s->exc[2*e+1] & 0xff),
+             (size_t)(s->exc[2*e+1] >> 8));
+  }
+
+  memset(out + len, 0, (size_t)(roundup(len+1, SALT_ALIGNMENT_MAX) - len));
+}
@@ -0,0 +1,273 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+#include "salt.h"
+
+/*
+
+  Work-stealing thread pool for loops over independent items
+
+  salt_pool_run(pool, n, grain, fn, data) calls fn(begin, end, tid, data)
+  on consecutive ranges of at most grain items until 0..n-1 are covered.
+  The ranges (tasks) are dealt out in contiguous blocks to one deque per
+  thread. Every thread takes tasks from the front of its own deque; when
+  it runs dry it steals the back half of the deque of another thread, so
+  threads that got cheap items keep helping the others until all deques
+  are empty.
+
+  The deques only hold a range of task numbers, so each one is protected
+  by its own mutex, which is taken once per task. The calling thread takes
+  part as thread 0 and the pool threads sleep between runs. Workspaces
+  that have to be private to a thread (such as those of the kernels) are
+  thread-local, and tid can be used to index per-thread results.
+
+*/
+
+typedef struct
+{
+  salt_pool_t * pool;
+  long tid;
+} pool_worker_t;
+
+static int deque_pop(salt_deque_t * dq, long * task)
+{
+  int found = 0;
+
+  pthread_mutex_lock(&dq->mutex);
+  if (dq->head < dq->tail)
+  {
+    *task = dq->head++;
+    found = 1;
+  }
+  pthread_mutex_unlock(&dq->mutex);
+
+  return found;
+}
+
+/* take the back half of the tasks of a victim; returns the number taken */
+static long deque_steal(salt_deque_t * dq, long * first)
+{
+  long count = 0;
+
+  pthread_mutex_lock(&dq->mutex);
+  if (dq->head < dq->tail)
+  {
+    count = (dq->tail - dq->head + 1) / 2;
+    dq->tail -= count;
+    *first = dq->tail;
+  }
+  pthread_mutex_unlock(&dq->mutex);
+
+  return count;
+}
+
+static void pool_task(salt_pool_t * pool, long task, long tid)
+{
+  long begin = task * pool->grain;
+  long end = begin + pool->grain;
+
+  if (end > pool->n)
+    end = pool->n;
+
+  pool->fn(begin, end, tid, pool->data);
+}
+
+static void pool_work(salt_pool_t * pool, long tid)
+{
+  salt_deque_t * own = pool->deque + tid;
+  long task;
+
+  while (1)
+  {
+    while (deque_pop(own, &task))
+      pool_task(pool, task, tid);
+
+    /* look for work at the other threads, starting with the next one */
+    long count = 0;
+    long first = 0;
+    for (long i = 1; i < pool->threads && !count; ++i)
+      count = deque_steal(pool->deque + (tid + i) % pool->threads, &first);
+
+    if (!count)
+      return;
+
+    pool->steals[tid]++;
+
+    /* keep the rest where others can steal it */
+    if (count > 1)
+    {
+      pthread_mutex_lock(&own->mutex);
+      own->head = first + 1;
+      own->tail = first + count;
+      pthread_mutex_unlock(&own->mutex);
+    }
+
+    pool_task(pool, first, tid);
+  }
+}
+
+static void * pool_thread(void * arg)
+{
+  pool_worker_t * worker = (pool_worker_t *) arg;
+  salt_pool_t * pool = worker->pool;
+  long generation = 0;
+
+  while (1)
+  {
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->generation == generation && !pool->quit)
+      pthread_cond_wait(&pool->start_cond, &pool->mutex);
+    generation = pool->generation;
+    int quit = pool->quit;
+    pthread_mutex_unlock(&pool->mutex);
+
+    if (quit)
+      break;
+
+    pool_work(pool, worker->tid);
+
+    pthread_mutex_lock(&pool->mutex);
+    if (--pool->running == 0)
+      pthread_cond_signal(&pool->done_cond);
+    pthread_mutex_unlock(&pool->mutex);
+  }
+
+  return NULL;
+}
+
+salt_pool_t * salt_pool_create(long threads)
+{
+  if (threads < 1)
+    fatal("Error: the number of threads must be positive");
+
+  salt_pool_t * pool = (salt_pool_t *) xmalloc(sizeof(salt_pool_t), 8);
+
+  pool->threads = threads;
+  pool->generation = 0;
+  pool->running = 0;
+  pool->quit = 0;
+
+  pool->deque = (salt_deque_t *) xmalloc(threads * sizeof(salt_deque_t),
+                                         SALT_CACHELINE);
+  pool->steals = (long *) xmalloc(threads * sizeof(long), 8);
+
+  for (long i = 0; i < threads; ++i)
+  {
+    pthread_mutex_init(&pool->deque[i].mutex, NULL);
+    pool->deque[i].head = pool->deque[i].tail = 0;
+    pool->steals[i] = 0;
+  }
+
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->start_cond, NULL);
+  pthread_cond_init(&pool->done_cond, NULL);
+
+  /* thread 0 is the caller of salt_pool_run */
+  pool->thread = (pthread_t *) xmalloc(threads * sizeof(pthread_t), 8);
+  pool_worker_t * worker = (pool_worker_t *) xmalloc(threads *
+                                                     sizeof(pool_worker_t),
+                                                     8);
+  pool->workers = worker;
+
+  for (long i = 1; i < threads; ++i)
+  {
+    worker[i].pool = pool;
+    worker[i].tid = i;
+    if (pthread_create(pool->thread + i, NULL, pool_thread, worker + i))
+      fatal("Cannot create thread");
+  }
+
+  return pool;
+}
+
+void salt_pool_destroy(salt_pool_t * pool)
+{
+  pthread_mutex_lock(&pool->mutex);
+  pool->quit = 1;
+  pthread_cond_broadcast(&pool->start_cond);
+  pthread_mutex_unlock(&pool->mutex);
+
+  for (long i = 1; i < pool->threads; ++i)
+    if (pthread_join(pool->thread[i], NULL))
+      fatal("Cannot join thread");
+
+  for (long i = 0; i < pool->threads; ++i)
+    pthread_mutex_destroy(&pool->deque[i].mutex);
+
+  pthread_mutex_destroy(&pool->mutex);
+  pthread_cond_destroy(&pool->start_cond);
+  pthread_cond_destroy(&pool->done_cond);
+
+  free(pool->workers);
+  free(pool->thread);
+  free(pool->steals);
+  free(pool->deque);
+  free(pool);
+}
+
+long salt_pool_threads(salt_pool_t * pool)
+{
+  return pool->threads;
+}
+
+void salt_pool_run(salt_pool_t * pool, long n, long grain,
+                   void (*fn)(long begin, long end, long tid, void * data),
+                   void * data)
+{
+  if (n <= 0)
+    return;
+
+  if (grain < 1)
+    grain = 1;
+
+  long tasks = (n + grain - 1) / grain;
+
+  pool->n = n;
+  pool->grain = grain;
+  pool->fn = fn;
+  pool->data = data;
+
+  /* deal out contiguous blocks of tasks */
+  for (long i = 0; i < pool->threads; ++i)
+  {
+    pool->deque[i].head = tasks * i / pool->threads;
+    pool->deque[i].tail = tasks * (i+1) / pool->threads;
+  }
+
+  if (pool->threads == 1)
+  {
+    pool_work(pool, 0);
+    return;
+  }
+
+  pthread_mutex_lock(&pool->mutex);
+  pool->running = pool->threads - 1;
+  pool->generation++;
+  pthread_cond_broadcast(&pool->start_cond);
+  pthread_mutex_unlock(&pool->mutex);
+
+  pool_work(pool, 0);
+
+  pthread_mutex_lock(&pool->mutex);
+  while (pool->running)
+    pthread_cond_wait(&pool->done_cond, &pool->mutex);
+  pthread_mutex_unlock(&pool->mutex);
+}
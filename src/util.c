@@ -19,6 +19,8 @@
     Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
 */
 
+#define _POSIX_C_SOURCE 200112L
+
 #include "salt.h"
 
 long gcd(long a, long b)
@@ -50,8 +52,13 @@ void fatal(const char * format, ...)
 
 void * xmalloc(size_t size, const size_t alignment)
 {
-  void * t;
-  posix_memalign(& t, alignment, size);
+  void * t = NULL;
+
+  /* malloc returns memory aligned to 16 bytes on x86-64 */
+  if (alignment <= 16)
+    t = malloc(size ? size : 1);
+  else if (posix_memalign(& t, alignment, size))
+    t = NULL;
 
   if (t==NULL)
     fatal("Unable to allocate enough memory.");
@@ -67,6 +74,116 @@ void * xrealloc(void *ptr, size_t size)
   return t;
 }
 
+void * xrealloc_aligned(void * ptr, size_t used, size_t size, size_t alignment)
+{
+  /* realloc does not preserve the alignment, hence copy by hand */
+  void * t = xmalloc(size, alignment);
+
+  if (used)
+    memcpy(t, ptr, used);
+  free(ptr);
+
+  return t;
+}
+
+/* open a file for reading, or standard input if the name is "-". The size
+   is set to -1 if the input cannot be seeked (pipes, fifos, terminals) */
+FILE * xfopen_input(const char * filename, long * filesize)
+{
+  FILE * fp;
+
+  if (!strcmp(filename, "-"))
+    fp = stdin;
+  else
+    fp = fopen(filename, "r");
+
+  if (!fp)
+    fatal("Error: Unable to open input file (%s)", filename);
+
+  if (fseek(fp, 0, SEEK_END))
+    *filesize = -1;
+  else
+  {
+    *filesize = ftell(fp);
+    rewind(fp);
+  }
+
+  return fp;
+}
+
+void xfclose_input(FILE * fp)
+{
+  if (fp != stdin)
+    fclose(fp);
+}
+
+/* progress indicator on stderr, shown only if stderr is a terminal. If the
+   size of the input is unknown the amount of data read is shown instead */
+
+static const char * progress_prompt;
+static long progress_size;
+static long progress_next;
+static long progress_step;
+static int progress_show;
+
+void progress_init(const char * prompt, long size)
+{
+  progress_show = isatty(STDERR_FILENO);
+  progress_prompt = prompt;
+  progress_size = size;
+  progress_step = (size > 0) ? (size+99) / 100 : 1024*1024;
+  progress_next = 0;
+
+  progress_update(0);
+}
+
+void progress_update(long progress)
+{
+  if (!progress_show || progress < progress_next)
+    return;
+
+  if (progress_size > 0)
+    fprintf(stderr, "\r%s %ld%%", progress_prompt,
+            100 * progress / progress_size);
+  else
+    fprintf(stderr, "\r%s %ld MB", progress_prompt, progress >> 20);
+
+  progress_next = progress + progress_step;
+}
+
+void progress_done()
+{
+  if (!progress_show)
+    return;
+
+  if (progress_size > 0)
+    fprintf(stderr, "\r%s 100%%\n", progress_prompt);
+  else
+    fprintf(stderr, "\r%s done\n", progress_prompt);
+}
+
+/* microseconds from an arbitrary starting point, for timing */
+long getusec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* cpu time and peak memory of the process, on stderr */
+void show_rusage()
+{
+  struct rusage r_usage;
+
+  getrusage(RUSAGE_SELF, & r_usage);
+
+  fprintf(stderr, "Time: %.3fs (user) %.3fs (sys) Memory: %.1lfMB\n",
+          r_usage.ru_utime.tv_sec * 1.0 + r_usage.ru_utime.tv_usec * 1.0e-6,
+          r_usage.ru_stime.tv_sec * 1.0 + r_usage.ru_stime.tv_usec * 1.0e-6,
+          r_usage.ru_maxrss / 1024.0);
+}
+
 char * xstrchrnul(char *s, int c)
 {
   char * r = strchr(s, c);
@@ -0,0 +1,231 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+#include "salt.h"
+
+/*
+
+  Streaming output of overlaps in PAF or GFA format
+
+  Every thread formats its records into a buffer of its own, which is
+  written to the file under a mutex whenever it is full, so threads only
+  contend once per SALT_WRITER_BUFSIZE bytes and at most one buffer per
+  thread is held in memory, however many overlaps are found. The order
+  of the records in the file is therefore not deterministic when more
+  than one thread is used.
+
+  PAF: one line per overlap, the query being read q and the target read
+  d of the overlap. The columns are query name, length, start, end,
+  relative strand, target name, length, start, end, number of matches,
+  overlap length and mapping quality (255, unknown), followed by the
+  score as AS:i tag. Coordinates are 0-based on the forward strands.
+
+  GFA (version 1): a header and one segment (S) per read are written when
+  the writer is opened; dovetail overlaps become links (L) and overlaps
+  covering a whole read become containments (C), all with an overlap of
+  <len>M as there are no gaps.
+
+*/
+
+static void writer_flush(salt_writer_t * w, salt_writer_buffer_t * b)
+{
+  if (!b->len)
+    return;
+
+  pthread_mutex_lock(&w->mutex);
+  if (fwrite(b->buf, 1, (size_t)b->len, w->fp) != (size_t)b->len)
+    fatal("Error: Unable to write overlaps");
+  w->bytes += b->len;
+  pthread_mutex_unlock(&w->mutex);
+
+  b->len = 0;
+}
+
+/* make room for at least size bytes in the buffer */
+static void writer_reserve(salt_writer_t * w, salt_writer_buffer_t * b,
+                           long size)
+{
+  if (b->len + size <= b->alloc)
+    return;
+
+  writer_flush(w, b);
+
+  /* the buffer is empty after the flush, the old one is simply dropped;
+     the arena is shared by all threads */
+  if (size > b->alloc)
+  {
+    b->alloc = size;
+    pthread_mutex_lock(&w->mutex);
+    b->buf = (char *) salt_arena_alloc(w->arena, (size_t)b->alloc, 8);
+    pthread_mutex_unlock(&w->mutex);
+  }
+}
+
+static long name_len(const char * head)
+{
+  return (long) strcspn(head, " \t");
+}
+
+static void writer_segments(salt_writer_t * w)
+{
+  salt_batch_t * batch = w->batch;
+  salt_writer_buffer_t * b = w->buffers;
+
+  writer_reserve(w, b, 32);
+  b->len += sprintf(b->buf + b->len, "H\tVN:Z:1.0\n");
+
+  for (long i = 0; i < batch->count; ++i)
+  {
+    char * head = SALT_BATCH_HEAD(batch, i);
+    long len = batch->seq_len[i];
+    long nlen = name_len(head);
+
+    writer_reserve(w, b, nlen + len + 64);
+    b->len += sprintf(b->buf + b->len, "S\t%.*s\t%.*s\tLN:i:%ld\n",
+                      (int)nlen, head, (int)len, SALT_BATCH_SEQ(batch, i),
+                      len);
+  }
+
+  writer_flush(w, b);
+}
+
+/* filename may be "-" (or NULL) for standard output; threads is the
+   number of threads that will report overlaps */
+salt_writer_t * salt_writer_open(const char * filename, int format,
+                                 long threads, salt_batch_t * batch)
+{
+  salt_writer_t * w = (salt_writer_t *) xmalloc(sizeof(salt_writer_t), 8);
+
+  if (format != SALT_FORMAT_PAF && format != SALT_FORMAT_GFA)
+    fatal("Error: unknown output format");
+
+  if (!filename || !strcmp(filename, "-"))
+    w->fp = stdout;
+  else if (!(w->fp = fopen(filename, "w")))
+    fatal("Unable to open output file for writing (%s)", filename);
+
+  w->format = format;
+  w->threads = threads;
+  w->batch = batch;
+  w->bytes = 0;
+
+  pthread_mutex_init(&w->mutex, NULL);
+
+  w->buffers = (salt_writer_buffer_t *) xmalloc(threads *
+                                                sizeof(salt_writer_buffer_t),
+                                                SALT_CACHELINE);
+  /* the buffers of all threads in one block, each on its own pages */
+  w->arena = salt_arena_create(threads * (SALT_WRITER_BUFSIZE + 4096),
+                               salt_arena_default_flags());
+
+  for (long i = 0; i < threads; ++i)
+  {
+    w->buffers[i].alloc = SALT_WRITER_BUFSIZE;
+    w->buffers[i].buf = (char *) salt_arena_alloc(w->arena,
+                                                  SALT_WRITER_BUFSIZE, 4096);
+    w->buffers[i].len = 0;
+    w->buffers[i].records = 0;
+  }
+
+  if (format == SALT_FORMAT_GFA)
+    writer_segments(w);
+
+  return w;
+}
+
+/* report callback for salt_allvsall, data is the writer */
+void salt_writer_report(const salt_overlap_t * ovl, long tid, void * data)
+{
+  salt_writer_t * w = (salt_writer_t *) data;
+  salt_writer_buffer_t * b = w->buffers + tid;
+  char * dhead = SALT_BATCH_HEAD(w->batch, ovl->d);
+  char * qhead = SALT_BATCH_HEAD(w->batch, ovl->q);
+  int dn = (int) name_len(dhead);
+  int qn = (int) name_len(qhead);
+  char strand = ovl->strand ? '-' : '+';
+
+  writer_reserve(w, b, dn + qn + 256);
+
+  char * p = b->buf + b->len;
+
+  if (w->format == SALT_FORMAT_PAF)
+  {
+    p += sprintf(p, "%.*s\t%ld\t%ld\t%ld\t%c\t%.*s\t%ld\t%ld\t%ld\t%ld\t%ld"
+                 "\t255\tAS:i:%ld\n",
+                 qn, qhead, ovl->qlen, ovl->qstart, ovl->qend, strand,
+                 dn, dhead, ovl->dlen, ovl->dstart, ovl->dend,
+                 ovl->matches, ovl->len, ovl->score);
+  }
+  else if (ovl->len == ovl->qlen)
+  {
+    /* q contained in d, at dstart */
+    p += sprintf(p, "C\t%.*s\t+\t%.*s\t%c\t%ld\t%ldM\n",
+                 dn, dhead, qn, qhead, strand, ovl->dstart, ovl->len);
+  }
+  else if (ovl->len == ovl->dlen)
+  {
+    /* d contained in q, at qstart on the forward strand of q */
+    p += sprintf(p, "C\t%.*s\t+\t%.*s\t%c\t%ld\t%ldM\n",
+                 qn, qhead, dn, dhead, strand, ovl->qstart, ovl->len);
+  }
+  else if (ovl->matchcase == 0)
+  {
+    /* suffix of d, prefix of q (or of its reverse complement) */
+    p += sprintf(p, "L\t%.*s\t+\t%.*s\t%c\t%ldM\n",
+                 dn, dhead, qn, qhead, strand, ovl->len);
+  }
+  else
+  {
+    /* prefix of d, suffix of q (or of its reverse complement) */
+    p += sprintf(p, "L\t%.*s\t%c\t%.*s\t+\t%ldM\n",
+                 qn, qhead, strand, dn, dhead, ovl->len);
+  }
+
+  b->len = p - b->buf;
+  b->records++;
+
+  if (b->len >= SALT_WRITER_BUFSIZE)
+    writer_flush(w, b);
+}
+
+/* flush all buffers and close the file; returns the number of records */
+long salt_writer_close(salt_writer_t * w)
+{
+  long records = 0;
+
+  for (long i = 0; i < w->threads; ++i)
+  {
+    writer_flush(w, w->buffers + i);
+    records += w->buffers[i].records;
+  }
+
+  if (w->fp == stdout)
+    fflush(stdout);
+  else if (fclose(w->fp))
+    fatal("Error: Unable to write overlaps");
+
+  pthread_mutex_destroy(&w->mutex);
+  salt_arena_destroy(w->arena);
+  free(w->buffers);
+  free(w);
+
+  return records;
+}
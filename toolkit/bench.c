@@ -0,0 +1,328 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+#include "salt.h"
+#include "toolkit.h"
+
+/*
+
+  Kernel benchmark
+
+  For every entry of the length grid a set of random overlapping pairs is
+  generated (with generate_pair) and every selected kernel is run over the
+  same pairs: once to warm up the caches and the kernel buffers, and to
+  check the results against the CPU kernel, then for a number of timed
+  trials. A grid entry is either a length L (pairs of two reads of length
+  L) or a range A-B (read lengths drawn uniformly from A..B).
+
+  For each kernel and grid entry the mean, standard deviation and minimum
+  of the wall time per trial are reported along with the mean number of
+  cycles (rdtsc), the cell updates per second (GCUPS, dlen*qlen cells per
+  pair) at the mean and at the best trial, the pairs per second, and the
+  number of pairs whose result differs from the CPU kernel. Differences on
+  pairs whose scores may not fit into the cells of the kernel (see
+  salt_kernel_fits) are counted as overflows, the others as wrong; only
+  the latter are warned about. With profile
+  set, the cycles and hardware counters per call of every stage of the
+  timed trials are listed on stderr (see stage.c).
+
+*/
+
+typedef struct
+{
+  long count;
+  BYTE ** dseq;
+  BYTE ** qseq;
+  long * dlen;
+  long * qlen;
+  long * result;
+  double cells;
+} bench_pairs_t;
+
+static void bench_encode(BYTE * s, long len)
+{
+  for (long i = 0; i < len; ++i)
+    s[i] = chrmap_2bit[s[i]];
+}
+
+static bench_pairs_t * bench_pairs_create(long count, long min_len,
+                                          long max_len, long min_overlap)
+{
+  bench_pairs_t * p = (bench_pairs_t *) xmalloc(sizeof(bench_pairs_t), 8);
+  long size = roundup(max_len + 1, SALT_ALIGNMENT_MAX);
+
+  p->count = count;
+  p->dseq = (BYTE **) xmalloc(count * sizeof(BYTE *), 8);
+  p->qseq = (BYTE **) xmalloc(count * sizeof(BYTE *), 8);
+  p->dlen = (long *) xmalloc(count * sizeof(long), 8);
+  p->qlen = (long *) xmalloc(count * sizeof(long), 8);
+  p->result = (long *) xmalloc(3 * count * sizeof(long), 8);
+  p->cells = 0;
+
+  if (min_overlap < 1)
+    min_overlap = 1;
+
+  for (long i = 0; i < count; ++i)
+  {
+    long dlen = random_int_range(min_len, max_len + 1);
+    long qlen = random_int_range(min_len, max_len + 1);
+    long lo = (2*min_overlap <= dlen + qlen) ? min_overlap : 1;
+    long overlap = random_int_range(lo, dlen + qlen - lo + 1);
+
+    p->dseq[i] = (BYTE *) xmalloc(size, SALT_ALIGNMENT_MAX);
+    p->qseq[i] = (BYTE *) xmalloc(size, SALT_ALIGNMENT_MAX);
+    memset(p->dseq[i], 0, size);
+    memset(p->qseq[i], 0, size);
+
+    generate_pair((char *)p->dseq[i], dlen, (char *)p->qseq[i], qlen,
+                  overlap);
+    bench_encode(p->dseq[i], dlen);
+    bench_encode(p->qseq[i], qlen);
+
+    p->dlen[i] = dlen;
+    p->qlen[i] = qlen;
+    p->cells += (double)dlen * (double)qlen;
+  }
+
+  return p;
+}
+
+static void bench_pairs_destroy(bench_pairs_t * p)
+{
+  for (long i = 0; i < p->count; ++i)
+  {
+    free(p->dseq[i]);
+    free(p->qseq[i]);
+  }
+  free(p->dseq);
+  free(p->qseq);
+  free(p->dlen);
+  free(p->qlen);
+  free(p->result);
+  free(p);
+}
+
+/* run the kernel over all pairs; with check set, compare the results with
+   those stored in p->result and return the number of differences on pairs
+   that fit into the kernel, those on the others go to overflows */
+static long bench_pass(const salt_kernel_t * kernel, salt_scoring_t * scoring,
+                       bench_pairs_t * p, int store, int check,
+                       long * overflows)
+{
+  long score, len, matchcase;
+  long wrong = 0;
+
+  if (overflows)
+    *overflows = 0;
+
+  for (long i = 0; i < p->count; ++i)
+  {
+    kernel->align(scoring,
+                  p->dseq[i], p->dseq[i] + p->dlen[i],
+                  p->qseq[i], p->qseq[i] + p->qlen[i],
+                  &score, &len, &matchcase);
+
+    long * r = p->result + 3*i;
+    if (store)
+    {
+      r[0] = score;
+      r[1] = len;
+      r[2] = matchcase;
+    }
+    else if (check && (r[0] != score || r[1] != len || r[2] != matchcase))
+    {
+      if (salt_kernel_fits(kernel, scoring, p->dlen[i], p->qlen[i]))
+        wrong++;
+      else
+        (*overflows)++;
+    }
+  }
+
+  return wrong;
+}
+
+static void bench_output(FILE * out, int json, int first,
+                         const salt_kernel_t * kernel,
+                         const char * grid, bench_pairs_t * p, long trials,
+                         double mean, double sd, double best,
+                         double cycles, long wrong, long overflows)
+{
+  double gcups = p->cells / mean / 1e9;
+  double gcups_best = p->cells / best / 1e9;
+  double pps = p->count / mean;
+
+  if (json)
+  {
+    fprintf(out,
+            "%s\n  { \"kernel\": \"%s\", \"bits\": %ld, \"lengths\": \"%s\", "
+            "\"pairs\": %ld, \"trials\": %ld, \"mean_s\": %.9f, "
+            "\"stddev_s\": %.9f, \"min_s\": %.9f, \"mean_cycles\": %.0f, "
+            "\"gcups\": %.6f, \"gcups_best\": %.6f, \"pairs_per_s\": %.1f, "
+            "\"wrong\": %ld, \"overflows\": %ld }",
+            first ? "" : ",", kernel->name, kernel->bits, grid, p->count,
+            trials, mean, sd, best, cycles, gcups, gcups_best, pps, wrong,
+            overflows);
+  }
+  else
+  {
+    fprintf(out, "%s,%ld,%s,%ld,%ld,%.9f,%.9f,%.9f,%.0f,%.6f,%.6f,%.1f,%ld,"
+            "%ld\n",
+            kernel->name, kernel->bits, grid, p->count, trials, mean, sd,
+            best, cycles, gcups, gcups_best, pps, wrong, overflows);
+  }
+}
+
+/* select the kernels from a comma separated list of names, or all those
+   supported by the cpu for NULL or "all"; returns their number */
+long bench_kernels(const char * algorithms, const salt_kernel_t ** kernels)
+{
+  long kcount = 0;
+
+  if (!algorithms || !strcmp(algorithms, "all"))
+  {
+    for (long i = 0; i < salt_kernel_count(); ++i)
+      if (salt_kernel_get(salt_kernel_at(i)->name))
+        kernels[kcount++] = salt_kernel_at(i);
+  }
+  else
+  {
+    char * list = xstrdup_aligned((char *)algorithms, 8);
+    for (char * name = strtok(list, ","); name; name = strtok(NULL, ","))
+    {
+      if (!(kernels[kcount] = salt_kernel_get(name)))
+        fatal("Unknown or unsupported algorithm: %s", name);
+      if (++kcount == BENCH_MAX_KERNELS)
+        break;
+    }
+    free(list);
+  }
+
+  return kcount;
+}
+
+void bench_run(const char * algorithms, const char * lengths, long pairs,
+               long trials, long warmup, long min_overlap, int json,
+               int profile, FILE * out)
+{
+  const salt_kernel_t * kernels[BENCH_MAX_KERNELS];
+  long kcount = bench_kernels(algorithms, kernels);
+
+  if (trials < 1)
+    fatal("The number of trials must be positive");
+
+  salt_scoring_t * scoring = salt_scoring_create(1, -1);
+  const salt_kernel_t * reference = salt_kernel_get("CPU");
+
+  if (json)
+    fprintf(out, "[");
+  else
+    fprintf(out, "kernel,bits,lengths,pairs,trials,mean_s,stddev_s,min_s,"
+                 "mean_cycles,gcups,gcups_best,pairs_per_s,wrong,"
+                 "overflows\n");
+
+  double * seconds = (double *) xmalloc(trials * sizeof(double), 8);
+  char * grid = xstrdup_aligned((char *)lengths, 8);
+  int first = 1;
+
+  for (char * entry = strtok(grid, ","); entry; entry = strtok(NULL, ","))
+  {
+    long min_len, max_len;
+
+    if (sscanf(entry, "%ld-%ld", &min_len, &max_len) != 2)
+      max_len = min_len = atol(entry);
+
+    if (min_len < 1 || max_len < min_len)
+      fatal("Illegal length grid entry: %s", entry);
+
+    bench_pairs_t * p = bench_pairs_create(pairs, min_len, max_len,
+                                           min_overlap);
+
+    /* reference results */
+    bench_pass(reference, scoring, p, 1, 0, NULL);
+
+    for (long k = 0; k < kcount; ++k)
+    {
+      long wrong = 0;
+      long overflows = 0;
+
+      for (long w = 0; w < (warmup > 1 ? warmup : 1); ++w)
+        wrong = bench_pass(kernels[k], scoring, p, 0, 1, &overflows);
+
+      double sum = 0;
+      double cycles = 0;
+      double best = 0;
+
+      salt_stage_reset_all();
+
+      for (long t = 0; t < trials; ++t)
+      {
+        unsigned long long c0 = __rdtsc();
+        long t0 = getusec();
+
+        bench_pass(kernels[k], scoring, p, 0, 0, NULL);
+
+        long t1 = getusec();
+        unsigned long long c1 = __rdtsc();
+
+        /* a trial faster than the clock resolution counts as 1us */
+        seconds[t] = (t1 > t0 ? t1 - t0 : 1) / 1e6;
+        sum += seconds[t];
+        cycles += (double)(c1 - c0);
+        if (t == 0 || seconds[t] < best)
+          best = seconds[t];
+      }
+
+      double mean = sum / trials;
+      double var = 0;
+      for (long t = 0; t < trials; ++t)
+        var += (seconds[t] - mean) * (seconds[t] - mean);
+      double sd = (trials > 1) ? sqrt(var / (trials - 1)) : 0;
+
+      bench_output(out, json, first, kernels[k], entry, p, trials,
+                   mean, sd, best, cycles / trials, wrong, overflows);
+      first = 0;
+
+      if (profile)
+      {
+        salt_stage_t stage;
+        char title[128];
+
+        salt_stage_total(&stage);
+        snprintf(title, 128, "Profile of %s on lengths %s:",
+                 kernels[k]->name, entry);
+        salt_stage_report(stderr, title, &stage);
+      }
+
+      if (wrong)
+        fprintf(stderr, "Warning: %s differs from CPU on %ld of %ld pairs "
+                "(lengths %s)\n", kernels[k]->name, wrong, p->count, entry);
+    }
+
+    bench_pairs_destroy(p);
+  }
+
+  if (json)
+    fprintf(out, "\n]\n");
+
+  free(grid);
+  free(seconds);
+  salt_scoring_destroy(scoring);
+}
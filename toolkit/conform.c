@@ -0,0 +1,391 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+
+#include "salt.h"
+#include "toolkit.h"
+
+/*
+
+  Conformance of the overlap kernels with the scalar reference
+
+  Every selected kernel is run on the same pairs as the CPU kernel and its
+  score, overlap length and match case are compared with those of the CPU
+  kernel. The pairs are made with generate_pair and the query is then
+  mutated with induce_errors at the given rate. Two sets of pairs are
+  checked:
+
+  - exhaustive: all database and query lengths from 1 to N, each with
+    every possible overlap length from 1 to dlen+qlen-1,
+
+  - random: for every entry of the length grid (a length L or a range
+    A-B, as for the benchmark), the given number of pairs with random
+    lengths and overlaps.
+
+  A kernel of 8 or 16 bits can only be exact as long as no cell of the DP
+  matrix exceeds its range, i.e. for min(dlen,qlen) times the largest
+  absolute score below 2^(bits-1) (salt_kernel_fits). Differences on
+  pairs beyond that are counted as overflows; all others are errors of
+  the kernel. As the 8-bit kernels overflow on most pairs of the grid, a
+  third set pairs reads of CONFORM_BAND_MIN..CONFORM_BAND_MAX with reads
+  short enough for every pair to fit into 8 bits.
+
+  With all kernels, the banded routine of --minimizers (BAND, see
+  overlap_nuc4_band.c) is checked too: on every other pair with a band
+  covering all diagonals, on the others with a narrow band around the
+  best diagonal of the CPU kernel, which must then find the same overlap.
+  Its cycles per cell and GCUPS count the cells of the whole matrix.
+
+  Every set is checked with each of the scoring schemes of conform_scoring,
+  which include a zero match and a positive mismatch score, as the kernels
+  build their profiles from the score matrix.
+
+  For every kernel the number of pairs, errors and overflows, the cycles
+  per cell and the cell updates per second (GCUPS) over all pairs are
+  reported, and the first few errors are listed on stderr.
+
+*/
+
+#define CONFORM_SHOW 10
+
+/* lengths of the long reads of the 8-bit band */
+#define CONFORM_BAND_MIN 100
+#define CONFORM_BAND_MAX 300
+
+/* match and mismatch scores */
+static const long conform_scoring[][2] =
+  {
+    { 1, -1 },
+    { 2, -3 },
+    { 1, -4 },
+    { 5, -4 },
+    { 0, -1 },
+    { 3, 1 },
+  };
+
+#define CONFORM_SCORINGS (long)(sizeof(conform_scoring) / \
+                                sizeof(conform_scoring[0]))
+
+/* largest narrow band of the banded routine */
+#define CONFORM_NARROW_BAND 8
+
+/* stands for the banded routine in the statistics */
+static const salt_kernel_t conform_band = { "BAND", 64, 0, NULL, NULL, NULL };
+
+typedef struct
+{
+  const salt_kernel_t * kernel;
+  long pairs;
+  long errors;
+  long overflows;
+  double cells;
+  double cycles;
+  double seconds;
+} conform_stat_t;
+
+typedef struct
+{
+  long count;
+  long alloc;
+  long bytes;
+  long size;
+  BYTE * arena;
+  long * dlen;
+  long * qlen;
+  long * result;
+} conform_pairs_t;
+
+static void conform_encode(BYTE * s, long len)
+{
+  for (long i = 0; i < len; ++i)
+    s[i] = chrmap_2bit[s[i]];
+}
+
+/* room for count pairs of sequences of length at most max_len */
+static void conform_pairs_reset(conform_pairs_t * p, long count, long max_len)
+{
+  long size = roundup(max_len + 1, SALT_ALIGNMENT_MAX);
+
+  if (count > p->alloc || 2 * count * size > p->bytes)
+  {
+    free(p->arena);
+    free(p->dlen);
+    free(p->qlen);
+    free(p->result);
+
+    p->alloc = count;
+    p->bytes = 2 * count * size;
+    p->arena = (BYTE *) xmalloc(p->bytes, SALT_ALIGNMENT_MAX);
+    p->dlen = (long *) xmalloc(count * sizeof(long), 8);
+    p->qlen = (long *) xmalloc(count * sizeof(long), 8);
+    p->result = (long *) xmalloc(3 * count * sizeof(long), 8);
+  }
+
+  p->size = size;
+  p->count = 0;
+  memset(p->arena, 0, 2 * count * size);
+}
+
+static BYTE * conform_dseq(conform_pairs_t * p, long i)
+{
+  return p->arena + 2*i*p->size;
+}
+
+static BYTE * conform_qseq(conform_pairs_t * p, long i)
+{
+  return p->arena + (2*i + 1)*p->size;
+}
+
+static void conform_add(conform_pairs_t * p, long dlen, long qlen,
+                        long overlap, double errors)
+{
+  long i = p->count++;
+  char * dseq = (char *) conform_dseq(p, i);
+  char * qseq = (char *) conform_qseq(p, i);
+
+  generate_pair(dseq, dlen, qseq, qlen, overlap);
+  if (errors > 0)
+    induce_errors(qseq, qlen, errors);
+
+  conform_encode((BYTE *)dseq, dlen);
+  conform_encode((BYTE *)qseq, qlen);
+
+  p->dlen[i] = dlen;
+  p->qlen[i] = qlen;
+}
+
+/* score pair i with the banded routine, given the reference result r;
+   the best diagonal k (position 0 of q against position k of d) is
+   dlen-len for match case 0 and len-qlen for match case 1 */
+static void conform_band_align(salt_scoring_t * scoring, conform_pairs_t * p,
+                               long i, const long * r, long * score,
+                               long * len, long * matchcase)
+{
+  BYTE * dseq = conform_dseq(p, i);
+  BYTE * qseq = conform_qseq(p, i);
+  long dlen = p->dlen[i];
+  long qlen = p->qlen[i];
+  long diag, band;
+
+  if (i & 1)
+  {
+    diag = 0;
+    band = dlen + qlen;
+  }
+  else
+  {
+    band = (i >> 1) % (CONFORM_NARROW_BAND + 1);
+    diag = (r[2] ? r[1] - qlen : dlen - r[1]) +
+           (i >> 1) % (2*band + 1) - band;
+  }
+
+  salt_overlap_nuc4_band(dseq, dseq + dlen, qseq, qseq + qlen,
+                         scoring->match, scoring->mismatch, diag, band,
+                         score, len, matchcase);
+}
+
+static void conform_check(conform_stat_t * stat, salt_scoring_t * scoring,
+                          conform_pairs_t * p, const salt_kernel_t * reference)
+{
+  long score, len, matchcase;
+
+  /* reference results */
+  if (stat->kernel == reference)
+  {
+    for (long i = 0; i < p->count; ++i)
+    {
+      long * r = p->result + 3*i;
+      BYTE * dseq = conform_dseq(p, i);
+      BYTE * qseq = conform_qseq(p, i);
+
+      reference->align(scoring, dseq, dseq + p->dlen[i], qseq,
+                       qseq + p->qlen[i], r, r+1, r+2);
+    }
+  }
+
+  long t0 = getusec();
+  unsigned long long c0 = __rdtsc();
+
+  for (long i = 0; i < p->count; ++i)
+  {
+    long * r = p->result + 3*i;
+    BYTE * dseq = conform_dseq(p, i);
+    BYTE * qseq = conform_qseq(p, i);
+
+    if (stat->kernel == &conform_band)
+      conform_band_align(scoring, p, i, r, &score, &len, &matchcase);
+    else
+      stat->kernel->align(scoring, dseq, dseq + p->dlen[i], qseq,
+                          qseq + p->qlen[i], &score, &len, &matchcase);
+
+    if (r[0] == score && r[1] == len && r[2] == matchcase)
+      continue;
+
+    if (!salt_kernel_fits(stat->kernel, scoring, p->dlen[i], p->qlen[i]))
+    {
+      stat->overflows++;
+      continue;
+    }
+
+    if (stat->errors++ < CONFORM_SHOW)
+      fprintf(stderr, "%s: scores %ld/%ld dlen %ld qlen %ld: score %ld len "
+              "%ld case %ld, expected score %ld len %ld case %ld\n",
+              stat->kernel->name, scoring->match, scoring->mismatch,
+              p->dlen[i], p->qlen[i], score, len, matchcase, r[0], r[1], r[2]);
+  }
+
+  unsigned long long c1 = __rdtsc();
+  long t1 = getusec();
+
+  stat->cycles += (double)(c1 - c0);
+  stat->seconds += (t1 - t0) / 1e6;
+  stat->pairs += p->count;
+  for (long i = 0; i < p->count; ++i)
+    stat->cells += (double)p->dlen[i] * (double)p->qlen[i];
+}
+
+/* check the pairs with each of the count scoring schemes */
+static void conform_batch(conform_stat_t * stats, long kcount,
+                          salt_scoring_t ** scoring, long count,
+                          conform_pairs_t * p,
+                          const salt_kernel_t * reference)
+{
+  /* the reference kernel is stats[0] */
+  for (long s = 0; s < count; ++s)
+    for (long k = 0; k < kcount; ++k)
+      conform_check(stats + k, scoring[s], p, reference);
+}
+
+/* returns the number of errors, over all kernels */
+long conform_run(const char * algorithms, const char * lengths, long pairs,
+                 long exhaustive, double errors, FILE * out)
+{
+  const salt_kernel_t * kernels[BENCH_MAX_KERNELS + 1];
+  long kcount = bench_kernels(algorithms, kernels);
+  const salt_kernel_t * reference = salt_kernel_get("CPU");
+
+  if (!algorithms || !strcmp(algorithms, "all"))
+    kernels[kcount++] = &conform_band;
+  conform_pairs_t p;
+  long total = 0;
+
+  if (errors < 0 || errors > 1)
+    fatal("The error rate must be between 0 and 1");
+
+  /* the reference runs first on every batch */
+  conform_stat_t * stats = (conform_stat_t *) xmalloc((kcount + 1) *
+                                                      sizeof(conform_stat_t),
+                                                      8);
+  memset(stats, 0, (kcount + 1) * sizeof(conform_stat_t));
+  stats[0].kernel = reference;
+  for (long k = 0; k < kcount; ++k)
+    stats[k+1].kernel = kernels[k];
+
+  memset(&p, 0, sizeof(conform_pairs_t));
+
+  salt_scoring_t * scoring[CONFORM_SCORINGS];
+  for (long s = 0; s < CONFORM_SCORINGS; ++s)
+    scoring[s] = salt_scoring_create(conform_scoring[s][0],
+                                     conform_scoring[s][1]);
+
+  /* exhaustive small lengths, one batch per pair of lengths */
+  for (long dlen = 1; dlen <= exhaustive; ++dlen)
+    for (long qlen = 1; qlen <= exhaustive; ++qlen)
+    {
+      conform_pairs_reset(&p, dlen + qlen - 1, exhaustive);
+      for (long overlap = 1; overlap < dlen + qlen; ++overlap)
+        conform_add(&p, dlen, qlen, overlap, errors);
+      conform_batch(stats, kcount + 1, scoring, CONFORM_SCORINGS, &p,
+                    reference);
+    }
+
+  /* long reads against reads short enough for 8 bits, either way round */
+  for (long s = 0; s < CONFORM_SCORINGS && pairs > 0; ++s)
+  {
+    long short_max = 127 / scoring[s]->maxabs;
+
+    conform_pairs_reset(&p, pairs, CONFORM_BAND_MAX);
+    for (long i = 0; i < pairs; ++i)
+    {
+      long dlen = random_int_range(CONFORM_BAND_MIN, CONFORM_BAND_MAX + 1);
+      long qlen = random_int_range(1, short_max + 1);
+
+      if (i & 1)
+        conform_add(&p, qlen, dlen, random_int_range(1, dlen + qlen), errors);
+      else
+        conform_add(&p, dlen, qlen, random_int_range(1, dlen + qlen), errors);
+    }
+    conform_batch(stats, kcount + 1, scoring + s, 1, &p, reference);
+  }
+
+  /* random lengths and overlaps */
+  char * grid = xstrdup_aligned((char *)(lengths ? lengths : ""), 8);
+
+  for (char * entry = strtok(grid, ","); entry; entry = strtok(NULL, ","))
+  {
+    long min_len, max_len;
+
+    if (sscanf(entry, "%ld-%ld", &min_len, &max_len) != 2)
+      max_len = min_len = atol(entry);
+
+    if (min_len < 1 || max_len < min_len)
+      fatal("Illegal length grid entry: %s", entry);
+
+    conform_pairs_reset(&p, pairs, max_len);
+    for (long i = 0; i < pairs; ++i)
+    {
+      long dlen = random_int_range(min_len, max_len + 1);
+      long qlen = random_int_range(min_len, max_len + 1);
+      conform_add(&p, dlen, qlen, random_int_range(1, dlen + qlen), errors);
+    }
+    conform_batch(stats, kcount + 1, scoring, CONFORM_SCORINGS, &p,
+                  reference);
+  }
+
+  fprintf(out, "kernel,bits,pairs,errors,overflows,cycles_per_cell,gcups\n");
+
+  for (long k = 1; k <= kcount; ++k)
+  {
+    conform_stat_t * s = stats + k;
+
+    fprintf(out, "%s,%ld,%ld,%ld,%ld,%.4f,%.6f\n", s->kernel->name,
+            s->kernel->bits, s->pairs, s->errors, s->overflows,
+            s->cells > 0 ? s->cycles / s->cells : 0,
+            s->seconds > 0 ? s->cells / s->seconds / 1e9 : 0);
+
+    if (s->errors)
+      fprintf(stderr, "Error: %s differs from CPU on %ld of %ld pairs\n",
+              s->kernel->name, s->errors, s->pairs);
+
+    total += s->errors;
+  }
+
+  free(grid);
+  free(p.arena);
+  free(p.dlen);
+  free(p.qlen);
+  free(p.result);
+  free(stats);
+  for (long s = 0; s < CONFORM_SCORINGS; ++s)
+    salt_scoring_destroy(scoring[s]);
+
+  return total;
+}
@@ -0,0 +1,487 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+
+#include "salt.h"
+
+/*
+
+  Microbenchmark of the stages of the overlap kernels
+
+  Every selected kernel is run on random overlapping pairs of a fixed
+  database length and each query length of the grid, with the stage
+  counters of stage.c switched on. For each kernel and query length the
+  cycles per call spent building the query profile, in the DP loop and in
+  the reduction are reported, along with the total cycles per call and the
+  DP cycles per cell. Every value is the minimum over the trials.
+
+  The default grid covers all sixteen values of qlen % 16 twice (these
+  select the amount of padding of the vector kernels and the instance of
+  their DP loop, which is specialized on the position of the last query
+  cell in its vector) and the common read lengths.
+
+  With --save the results are also written to a file, and with --baseline
+  a previously saved file is read and every result is printed with its
+  change in percent against the baseline. Changes of the total beyond
+  --threshold percent are marked as slower or faster, and the exit status
+  is 1 if any result got slower.
+
+*/
+
+#define KERNEL_NAME_MAX 32
+
+/* the stages of the kernels: profile, dp and reduce */
+#define MICRO_STAGES 3
+
+typedef struct
+{
+  char kernel[KERNEL_NAME_MAX];
+  long bits;
+  long qlen;
+  long dlen;
+  double stage[MICRO_STAGES];
+  double total;
+} micro_result_t;
+
+static char * progname;
+static char * opt_algorithm;
+static char * opt_qlens;
+static char * opt_save;
+static char * opt_baseline;
+static long opt_dlen;
+static long opt_pairs;
+static long opt_calls;
+static long opt_trials;
+static long opt_seed;
+static double opt_threshold;
+static int opt_help;
+
+static micro_result_t * baseline;
+static long baseline_count;
+
+static void usage()
+{
+  fprintf(stderr,
+          "Usage: %s [OPTIONS]\n"
+          "  --algorithm LIST   comma separated kernels (default: all)\n"
+          "  --qlens LIST       query lengths, N or A-B for A..B "
+                               "(default: 16-47,128-143,150,250,300)\n"
+          "  --dlen N           database sequence length (default: 250)\n"
+          "  --pairs N          number of random pairs (default: 64)\n"
+          "  --calls N          kernel calls per trial (default: 256)\n"
+          "  --trials N         number of trials (default: 5)\n"
+          "  --seed N           seed of the random pairs (default: 1)\n"
+          "  --save FILE        save the results as baseline to FILE\n"
+          "  --baseline FILE    compare the results with those in FILE\n"
+          "  --threshold PCT    change of the total that is reported "
+                               "(default: 5)\n"
+          "  --help             print this help\n",
+          progname);
+}
+
+static void args_init(int argc, char ** argv)
+{
+  progname = argv[0];
+
+  opt_algorithm = NULL;
+  opt_qlens     = "16-47,128-143,150,250,300";
+  opt_save      = NULL;
+  opt_baseline  = NULL;
+  opt_dlen      = 250;
+  opt_pairs     = 64;
+  opt_calls     = 256;
+  opt_trials    = 5;
+  opt_seed      = 1;
+  opt_threshold = 5;
+  opt_help      = 0;
+
+  static struct option long_options[] =
+  {
+    {"help",          no_argument,       0, 0 },
+    {"algorithm",     required_argument, 0, 0 },
+    {"qlens",         required_argument, 0, 0 },
+    {"dlen",          required_argument, 0, 0 },
+    {"pairs",         required_argument, 0, 0 },
+    {"calls",         required_argument, 0, 0 },
+    {"trials",        required_argument, 0, 0 },
+    {"seed",          required_argument, 0, 0 },
+    {"save",          required_argument, 0, 0 },
+    {"baseline",      required_argument, 0, 0 },
+    {"threshold",     required_argument, 0, 0 },
+    { 0, 0, 0, 0 }
+  };
+
+  int option_index = 0;
+  int c;
+
+  while ((c = getopt_long_only(argc, argv, "", long_options, &option_index)) == 0)
+  {
+    switch (option_index)
+    {
+      case 0:
+        opt_help = 1;
+        break;
+
+      case 1:
+        opt_algorithm = optarg;
+        break;
+
+      case 2:
+        opt_qlens = optarg;
+        break;
+
+      case 3:
+        opt_dlen = atol(optarg);
+        break;
+
+      case 4:
+        opt_pairs = atol(optarg);
+        break;
+
+      case 5:
+        opt_calls = atol(optarg);
+        break;
+
+      case 6:
+        opt_trials = atol(optarg);
+        break;
+
+      case 7:
+        opt_seed = atol(optarg);
+        break;
+
+      case 8:
+        opt_save = optarg;
+        break;
+
+      case 9:
+        opt_baseline = optarg;
+        break;
+
+      case 10:
+        opt_threshold = atof(optarg);
+        break;
+
+      default:
+        fatal("Internal error in option parsing");
+    }
+  }
+
+  if (c != -1 || optind < argc)
+  {
+    usage();
+    exit(EXIT_FAILURE);
+  }
+
+  if (opt_dlen < 1 || opt_pairs < 1 || opt_calls < 1 || opt_trials < 1)
+    fatal("The database length, pairs, calls and trials must be positive");
+}
+
+static void encode(BYTE * s, long len)
+{
+  for (long i = 0; i < len; ++i)
+    s[i] = chrmap_2bit[s[i]];
+}
+
+/* count pairs of a database sequence of length dlen and a query of length
+   qlen, 2-bit encoded and zero padded; all pairs share one arena */
+static BYTE * pairs_create(long count, long dlen, long qlen, long * stride)
+{
+  long size = roundup((dlen > qlen ? dlen : qlen) + 1, SALT_ALIGNMENT_MAX);
+  BYTE * arena = (BYTE *) xmalloc(2 * count * size, SALT_ALIGNMENT_MAX);
+
+  memset(arena, 0, 2 * count * size);
+
+  for (long i = 0; i < count; ++i)
+  {
+    BYTE * dseq = arena + 2*i*size;
+    BYTE * qseq = dseq + size;
+
+    generate_pair((char *)dseq, dlen, (char *)qseq, qlen,
+                  random_int_range(1, dlen + qlen));
+    dseq[dlen] = qseq[qlen] = 0;
+    encode(dseq, dlen);
+    encode(qseq, qlen);
+  }
+
+  *stride = size;
+  return arena;
+}
+
+static void measure(const salt_kernel_t * kernel, salt_scoring_t * scoring,
+                    long qlen, micro_result_t * r)
+{
+  long stride;
+  BYTE * arena = pairs_create(opt_pairs, opt_dlen, qlen, &stride);
+  long score, len, matchcase;
+  salt_stage_t stage;
+
+  strncpy(r->kernel, kernel->name, KERNEL_NAME_MAX - 1);
+  r->kernel[KERNEL_NAME_MAX - 1] = 0;
+  r->bits = kernel->bits;
+  r->qlen = qlen;
+  r->dlen = opt_dlen;
+
+  /* warm up the caches and the kernel buffers */
+  for (long i = 0; i < opt_pairs; ++i)
+  {
+    BYTE * dseq = arena + 2*i*stride;
+    BYTE * qseq = dseq + stride;
+    kernel->align(scoring, dseq, dseq + opt_dlen, qseq, qseq + qlen,
+                  &score, &len, &matchcase);
+  }
+
+  for (long t = 0; t < opt_trials; ++t)
+  {
+    salt_stage_reset();
+
+    unsigned long long c0 = __rdtsc();
+
+    for (long i = 0; i < opt_calls; ++i)
+    {
+      BYTE * dseq = arena + 2*(i % opt_pairs)*stride;
+      BYTE * qseq = dseq + stride;
+      kernel->align(scoring, dseq, dseq + opt_dlen, qseq, qseq + qlen,
+                    &score, &len, &matchcase);
+    }
+
+    unsigned long long c1 = __rdtsc();
+
+    salt_stage_get(&stage);
+
+    double total = (double)(c1 - c0) / opt_calls;
+    if (t == 0 || total < r->total)
+      r->total = total;
+
+    for (long s = 0; s < MICRO_STAGES; ++s)
+    {
+      double cycles = stage.calls[s] ?
+                      (double)stage.cycles[s] / stage.calls[s] : 0;
+      if (t == 0 || cycles < r->stage[s])
+        r->stage[s] = cycles;
+    }
+  }
+
+  free(arena);
+}
+
+static void print_header(FILE * fp, int compare)
+{
+  fprintf(fp, "kernel,bits,qlen,qlen_mod16,dlen");
+  for (long s = 0; s < MICRO_STAGES; ++s)
+    fprintf(fp, ",%s", salt_stage_name(s));
+  fprintf(fp, ",total,dp_per_cell");
+
+  if (compare)
+  {
+    fprintf(fp, ",base_total");
+    for (long s = 0; s < MICRO_STAGES; ++s)
+      fprintf(fp, ",%s_pct", salt_stage_name(s));
+    fprintf(fp, ",total_pct,change");
+  }
+
+  fprintf(fp, "\n");
+}
+
+static void print_result(FILE * fp, micro_result_t * r)
+{
+  fprintf(fp, "%s,%ld,%ld,%ld,%ld", r->kernel, r->bits, r->qlen, r->qlen % 16,
+          r->dlen);
+  for (long s = 0; s < MICRO_STAGES; ++s)
+    fprintf(fp, ",%.1f", r->stage[s]);
+  fprintf(fp, ",%.1f,%.4f", r->total,
+          r->stage[SALT_STAGE_DP] / ((double)r->qlen * r->dlen));
+}
+
+static double change(double now, double base)
+{
+  return base > 0 ? 100.0 * (now - base) / base : 0;
+}
+
+/* print a result with its change against the baseline; returns 1 if the
+   total got slower by more than the threshold */
+static int print_compare(FILE * fp, micro_result_t * r)
+{
+  micro_result_t * b = NULL;
+
+  for (long i = 0; i < baseline_count && !b; ++i)
+    if (!strcmp(baseline[i].kernel, r->kernel) &&
+        baseline[i].qlen == r->qlen && baseline[i].dlen == r->dlen)
+      b = baseline + i;
+
+  print_result(fp, r);
+
+  if (!b)
+  {
+    fprintf(fp, ",,,,,,new\n");
+    return 0;
+  }
+
+  double total = change(r->total, b->total);
+  const char * verdict = "";
+
+  if (total > opt_threshold)
+    verdict = "slower";
+  else if (total < -opt_threshold)
+    verdict = "faster";
+
+  fprintf(fp, ",%.1f", b->total);
+  for (long s = 0; s < MICRO_STAGES; ++s)
+    fprintf(fp, ",%+.1f", change(r->stage[s], b->stage[s]));
+  fprintf(fp, ",%+.1f,%s\n", total, verdict);
+
+  return total > opt_threshold;
+}
+
+static void baseline_load(const char * filename)
+{
+  FILE * fp = fopen(filename, "r");
+  char line[LINE_MAX];
+  long alloc = 0;
+
+  if (!fp)
+    fatal("Unable to open baseline file for reading (%s)", filename);
+
+  baseline = NULL;
+  baseline_count = 0;
+
+  /* skip the header */
+  if (!fgets(line, LINE_MAX, fp))
+    fatal("Empty baseline file (%s)", filename);
+
+  while (fgets(line, LINE_MAX, fp))
+  {
+    micro_result_t r;
+    long mod;
+
+    if (baseline_count == alloc)
+    {
+      alloc = alloc ? 2*alloc : 64;
+      baseline = (micro_result_t *) xrealloc(baseline, alloc *
+                                             sizeof(micro_result_t));
+    }
+
+    if (sscanf(line, "%31[^,],%ld,%ld,%ld,%ld,%lf,%lf,%lf,%lf",
+               r.kernel, &r.bits, &r.qlen, &mod, &r.dlen, &r.stage[0],
+               &r.stage[1], &r.stage[2], &r.total) != 9)
+      fatal("Illegal line in baseline file (%s): %s", filename, line);
+
+    baseline[baseline_count++] = r;
+  }
+
+  fclose(fp);
+}
+
+int main(int argc, char ** argv)
+{
+  const salt_kernel_t * kernels[64];
+  long kcount = 0;
+  int slower = 0;
+
+  args_init(argc, argv);
+
+  if (opt_help)
+  {
+    usage();
+    return 0;
+  }
+
+  if (!opt_algorithm || !strcmp(opt_algorithm, "all"))
+  {
+    for (long i = 0; i < salt_kernel_count(); ++i)
+      if (salt_kernel_get(salt_kernel_at(i)->name))
+        kernels[kcount++] = salt_kernel_at(i);
+  }
+  else
+  {
+    char * list = xstrdup_aligned(opt_algorithm, 8);
+    for (char * name = strtok(list, ","); name; name = strtok(NULL, ","))
+    {
+      if (!(kernels[kcount] = salt_kernel_get(name)))
+        fatal("Unknown or unsupported algorithm: %s", name);
+      if (++kcount == 64)
+        break;
+    }
+    free(list);
+  }
+
+  if (opt_baseline)
+    baseline_load(opt_baseline);
+
+  FILE * save = NULL;
+  if (opt_save && !(save = fopen(opt_save, "w")))
+    fatal("Unable to open output file for writing (%s)", opt_save);
+
+  random_seed(opt_seed);
+
+  salt_scoring_t * scoring = salt_scoring_create(1, -1);
+  salt_stage_enable(SALT_STAGE_CYCLES);
+
+  print_header(stdout, opt_baseline != NULL);
+  if (save)
+    print_header(save, 0);
+
+  char * grid = xstrdup_aligned(opt_qlens, 8);
+
+  for (char * entry = strtok(grid, ","); entry; entry = strtok(NULL, ","))
+  {
+    long min_len, max_len;
+
+    if (sscanf(entry, "%ld-%ld", &min_len, &max_len) != 2)
+      max_len = min_len = atol(entry);
+
+    if (min_len < 1 || max_len < min_len)
+      fatal("Illegal query length: %s", entry);
+
+    for (long qlen = min_len; qlen <= max_len; ++qlen)
+      for (long k = 0; k < kcount; ++k)
+      {
+        micro_result_t r;
+
+        measure(kernels[k], scoring, qlen, &r);
+
+        if (opt_baseline)
+          slower |= print_compare(stdout, &r);
+        else
+        {
+          print_result(stdout, &r);
+          fprintf(stdout, "\n");
+        }
+
+        if (save)
+        {
+          print_result(save, &r);
+          fprintf(save, "\n");
+        }
+      }
+  }
+
+  salt_stage_enable(SALT_STAGE_OFF);
+
+  if (save && fclose(save))
+    fatal("Unable to write output file (%s)", opt_save);
+
+  free(grid);
+  free(baseline);
+  salt_scoring_destroy(scoring);
+
+  return slower;
+}
@@ -20,21 +20,60 @@
 */
 
 #include "salt.h"
+#include "toolkit.h"
 #include <assert.h>
 #include <time.h>
 
 static char * progname;
 char * opt_list_reads;
+char * opt_list_fastq;
+char * opt_build_store;
+char * opt_list_store;
+char * opt_output;
+char * opt_faidx;
+char * opt_region;
 char * opt_overlap_file;
+char * opt_allvsall;
 char * opt_algorithm;
+char * opt_simulate;
+char * opt_mates;
+char * opt_genome;
 
 int    opt_run_test;
+int    opt_conformance;
+int    opt_exhaustive;
+double opt_errors;
+long   opt_reads;
+long   opt_genome_len;
+int    opt_paired;
+long   opt_insert_size;
+long   opt_insert_sd;
+double opt_sub_rate;
+double opt_ins_rate;
+double opt_del_rate;
+double opt_n_rate;
+int    opt_profile;
+char * opt_stats;
+int    opt_hugepages;
+int    opt_prefault;
 int    opt_runs;
 int    opt_reads_min_len;
 int    opt_reads_max_len;
 int    opt_min_overlap;
 int    opt_verbose;
 int    opt_seed;
+int    opt_fastq_ascii;
+int    opt_threads;
+int    opt_both_strands;
+int    opt_minimizers;
+int    opt_kmer_len;
+int    opt_window;
+int    opt_band;
+char * opt_format;
+char * opt_lengths;
+int    opt_pairs;
+int    opt_warmup;
+double opt_min_identity;
 
 char * infilename;
 
@@ -54,16 +93,54 @@ void args_init(int argc, char **argv)
   opt_help          = 0;
   opt_version       = 0;
   opt_list_reads    = 0;
+  opt_list_fastq    = 0;
+  opt_build_store   = 0;
+  opt_list_store    = 0;
+  opt_output        = 0;
+  opt_faidx         = 0;
+  opt_region        = 0;
   opt_overlap_file  = 0;
+  opt_allvsall      = 0;
 
-  opt_algorithm     = xstrdup_aligned("CPU",8);
+  opt_algorithm     = 0;
   opt_run_test      = 0;
+  opt_conformance   = 0;
+  opt_exhaustive    = 32;
+  opt_errors        = 0.02;
+  opt_simulate      = 0;
+  opt_mates         = 0;
+  opt_genome        = 0;
+  opt_reads         = 100000;
+  opt_genome_len    = 1000000;
+  opt_paired        = 0;
+  opt_insert_size   = 500;
+  opt_insert_sd     = 50;
+  opt_sub_rate      = 0;
+  opt_ins_rate      = 0;
+  opt_del_rate      = 0;
+  opt_n_rate        = 0;
+  opt_profile       = 0;
+  opt_stats         = NULL;
+  opt_hugepages     = 0;
+  opt_prefault      = 0;
   opt_runs          = 10;
   opt_reads_min_len = 150;
   opt_reads_max_len = 300;
   opt_min_overlap   = 20;
   opt_verbose       = 0;
   opt_seed          = time(NULL);
+  opt_fastq_ascii   = 33;
+  opt_threads       = 1;
+  opt_both_strands  = 0;
+  opt_min_identity  = 0.0;
+  opt_minimizers    = 0;
+  opt_kmer_len      = 15;
+  opt_window        = 10;
+  opt_band          = 16;
+  opt_format        = 0;
+  opt_lengths       = 0;
+  opt_pairs         = 1000;
+  opt_warmup        = 1;
 
   static struct option long_options[] =
   {
@@ -79,6 +156,44 @@ void args_init(int argc, char **argv)
     {"min_overlap",   required_argument, 0, 0 },
     {"verbose",       no_argument,       0, 0 },
     {"seed",          required_argument, 0, 0 },
+    {"list-fastq",    required_argument, 0, 0 },
+    {"fastq_ascii",   required_argument, 0, 0 },
+    {"threads",       required_argument, 0, 0 },
+    {"build-store",   required_argument, 0, 0 },
+    {"list-store",    required_argument, 0, 0 },
+    {"output",        required_argument, 0, 0 },
+    {"faidx",         required_argument, 0, 0 },
+    {"region",        required_argument, 0, 0 },
+    {"allvsall",      required_argument, 0, 0 },
+    {"min_identity",  required_argument, 0, 0 },
+    {"both_strands",  no_argument,       0, 0 },
+    {"minimizers",    no_argument,       0, 0 },
+    {"kmer_len",      required_argument, 0, 0 },
+    {"window",        required_argument, 0, 0 },
+    {"band",          required_argument, 0, 0 },
+    {"format",        required_argument, 0, 0 },
+    {"lengths",       required_argument, 0, 0 },
+    {"pairs",         required_argument, 0, 0 },
+    {"warmup",        required_argument, 0, 0 },
+    {"conformance",   no_argument,       0, 0 },
+    {"exhaustive",    required_argument, 0, 0 },
+    {"errors",        required_argument, 0, 0 },
+    {"simulate",      required_argument, 0, 0 },
+    {"reads",         required_argument, 0, 0 },
+    {"genome_len",    required_argument, 0, 0 },
+    {"paired",        no_argument,       0, 0 },
+    {"insert_size",   required_argument, 0, 0 },
+    {"insert_sd",     required_argument, 0, 0 },
+    {"sub_rate",      required_argument, 0, 0 },
+    {"ins_rate",      required_argument, 0, 0 },
+    {"del_rate",      required_argument, 0, 0 },
+    {"n_rate",        required_argument, 0, 0 },
+    {"mates",         required_argument, 0, 0 },
+    {"genome",        required_argument, 0, 0 },
+    {"profile",       no_argument,       0, 0 },
+    {"stats",         required_argument, 0, 0 },
+    {"hugepages",     no_argument,       0, 0 },
+    {"prefault",      no_argument,       0, 0 },
     { 0, 0, 0, 0 }
   };
 
@@ -111,7 +226,6 @@ void args_init(int argc, char **argv)
 
        case 4:
          /* select algorithm */
-         free (opt_algorithm);
          opt_algorithm = optarg;
          break;
 
@@ -150,6 +264,211 @@ void args_init(int argc, char **argv)
          opt_seed = atoi(optarg);
          break;
 
+       case 12:
+         /* list-fastq */
+         opt_list_fastq = optarg;
+         break;
+
+       case 13:
+         /* fastq_ascii */
+         opt_fastq_ascii = atoi(optarg);
+         if (opt_fastq_ascii != 33 && opt_fastq_ascii != 64)
+           fatal("The argument to --fastq_ascii must be 33 or 64");
+         break;
+
+       case 14:
+         /* threads */
+         opt_threads = atoi(optarg);
+         if (opt_threads < 1)
+           fatal("The argument to --threads must be positive");
+         break;
+
+       case 15:
+         /* build-store */
+         opt_build_store = optarg;
+         break;
+
+       case 16:
+         /* list-store */
+         opt_list_store = optarg;
+         break;
+
+       case 17:
+         /* output */
+         opt_output = optarg;
+         break;
+
+       case 18:
+         /* faidx */
+         opt_faidx = optarg;
+         break;
+
+       case 19:
+         /* region */
+         opt_region = optarg;
+         break;
+
+       case 20:
+         /* allvsall */
+         opt_allvsall = optarg;
+         break;
+
+       case 21:
+         /* min_identity */
+         opt_min_identity = atof(optarg);
+         if (opt_min_identity < 0 || opt_min_identity > 1)
+           fatal("The argument to --min_identity must be between 0 and 1");
+         break;
+
+       case 22:
+         /* both_strands */
+         opt_both_strands = 1;
+         break;
+
+       case 23:
+         /* minimizers */
+         opt_minimizers = 1;
+         break;
+
+       case 24:
+         /* kmer_len */
+         opt_kmer_len = atoi(optarg);
+         if (opt_kmer_len < 1 || opt_kmer_len > 31)
+           fatal("The argument to --kmer_len must be between 1 and 31");
+         break;
+
+       case 25:
+         /* window */
+         opt_window = atoi(optarg);
+         if (opt_window < 1 || opt_window > SALT_MINIMIZER_MAX_W)
+           fatal("The argument to --window must be between 1 and %d",
+                 SALT_MINIMIZER_MAX_W);
+         break;
+
+       case 26:
+         /* band */
+         opt_band = atoi(optarg);
+         break;
+
+       case 27:
+         /* format */
+         opt_format = optarg;
+         break;
+
+       case 28:
+         /* lengths */
+         opt_lengths = optarg;
+         break;
+
+       case 29:
+         /* pairs */
+         opt_pairs = atoi(optarg);
+         if (opt_pairs < 1)
+           fatal("The argument to --pairs must be positive");
+         break;
+
+       case 30:
+         /* warmup */
+         opt_warmup = atoi(optarg);
+         break;
+
+       case 31:
+         /* conformance */
+         opt_conformance = 1;
+         break;
+
+       case 32:
+         /* exhaustive */
+         opt_exhaustive = atoi(optarg);
+         break;
+
+       case 33:
+         /* errors */
+         opt_errors = atof(optarg);
+         if (opt_errors < 0 || opt_errors > 1)
+           fatal("The argument to --errors must be between 0 and 1");
+         break;
+
+       case 34:
+         /* simulate */
+         opt_simulate = optarg;
+         break;
+
+       case 35:
+         /* reads */
+         opt_reads = atol(optarg);
+         break;
+
+       case 36:
+         /* genome_len */
+         opt_genome_len = atol(optarg);
+         break;
+
+       case 37:
+         /* paired */
+         opt_paired = 1;
+         break;
+
+       case 38:
+         /* insert_size */
+         opt_insert_size = atol(optarg);
+         break;
+
+       case 39:
+         /* insert_sd */
+         opt_insert_sd = atol(optarg);
+         break;
+
+       case 40:
+         /* sub_rate */
+         opt_sub_rate = atof(optarg);
+         break;
+
+       case 41:
+         /* ins_rate */
+         opt_ins_rate = atof(optarg);
+         break;
+
+       case 42:
+         /* del_rate */
+         opt_del_rate = atof(optarg);
+         break;
+
+       case 43:
+         /* n_rate */
+         opt_n_rate = atof(optarg);
+         break;
+
+       case 44:
+         /* mates */
+         opt_mates = optarg;
+         break;
+
+       case 45:
+         /* genome */
+         opt_genome = optarg;
+         break;
+
+       case 46:
+         /* profile */
+         opt_profile = 1;
+         break;
+
+       case 47:
+         /* stats */
+         opt_stats = optarg;
+         break;
+
+       case 48:
+         /* hugepages */
+         opt_hugepages = 1;
+         break;
+
+       case 49:
+         /* prefault */
+         opt_prefault = 1;
+         break;
+
        default:
          fatal("Internal error in option parsing");
      }
@@ -161,10 +480,24 @@ void args_init(int argc, char **argv)
   int commands = 0;
   if (opt_list_reads)
     commands++;
+  if (opt_list_fastq)
+    commands++;
+  if (opt_build_store)
+    commands++;
+  if (opt_list_store)
+    commands++;
+  if (opt_faidx)
+    commands++;
   if (opt_overlap_file)
     commands++;
+  if (opt_allvsall)
+    commands++;
   if (opt_run_test)
     commands++;
+  if (opt_conformance)
+    commands++;
+  if (opt_simulate)
+    commands++;
   if (opt_help)
     commands++;
   if (opt_version)
@@ -187,6 +520,64 @@ void cmd_help()
            "  --help                      display help information\n"
            "  --version                   display version information\n"
            "  --list-reads FILENAME       display reads in input fasta file\n"
+           "  --list-fastq FILENAME       display reads in input fastq file\n"
+           "  --fastq_ascii INT           quality offset of fastq input, 33 or 64 (33)\n"
+           "  --threads INT               number of threads to use (1)\n"
+           "  --build-store FILENAME      encode fasta file into a binary read store\n"
+           "  --list-store FILENAME       display reads in binary read store\n"
+           "  --output FILENAME           output file\n"
+           "  --faidx FILENAME            index fasta file (FILENAME.fai)\n"
+           "  --region STRING             with --faidx, display name[:beg-end] or #ordinal\n"
+           "  --allvsall FILENAME         overlap all reads with each other\n"
+           "  --algorithm STRING          kernel: CPU, SSE8, SSE8U, SSE16, AVX8, AVX16,\n"
+           "                              AVX8L, AVX16L, AVX8D, AVX16D, SSE32, AVX32D or\n"
+           "                              AUTO (8, 16 or 32 bits by pair)\n"
+           "                              (CPU); a list or all (default) with --test\n"
+           "  --min_overlap INT           minimum overlap length (20)\n"
+           "  --min_identity REAL         minimum fraction of matches in overlaps (0.0)\n"
+           "  --both_strands              also overlap with reverse complemented reads\n"
+           "  --minimizers                only overlap reads sharing minimizers\n"
+           "  --kmer_len INT              minimizer k-mer length (15)\n"
+           "  --window INT                minimizer window in k-mers (10)\n"
+           "  --band INT                  diagonals scored on either side of the\n"
+           "                              minimizer diagonal, -1 for all with the\n"
+           "                              kernel of --algorithm (16)\n"
+           "  --format STRING             output format: paf or gfa for overlaps (paf),\n"
+           "                              csv or json for benchmarks (csv), fasta or\n"
+           "                              fastq for simulated reads (fasta)\n"
+           "  --test                      benchmark the overlap kernels\n"
+           "  --lengths LIST              benchmark read lengths, e.g. 150,250,150-300\n"
+           "                              (reads_min_len-reads_max_len)\n"
+           "  --reads_min_len INT         minimum benchmark read length (150)\n"
+           "  --reads_max_len INT         maximum benchmark read length (300)\n"
+           "  --pairs INT                 benchmark pairs per length (1000)\n"
+           "  --runs INT                  timed benchmark trials (10)\n"
+           "  --warmup INT                untimed benchmark passes (1)\n"
+           "  --conformance               check the kernels against the CPU kernel on\n"
+           "                              all small and random --lengths (1-1000)\n"
+           "  --exhaustive INT            all lengths up to INT with --conformance (32)\n"
+           "  --errors REAL               error rate of generated queries (0.02)\n"
+           "  --simulate FILENAME         simulate reads from a random genome\n"
+           "  --reads INT                 simulated reads or pairs (100000)\n"
+           "  --genome_len INT            length of the simulated genome (1000000)\n"
+           "  --genome FILENAME           also write the simulated genome\n"
+           "  --paired                    simulate pairs of reads\n"
+           "  --mates FILENAME            second mates of pairs (after the first ones)\n"
+           "  --insert_size INT           mean fragment length of pairs (500)\n"
+           "  --insert_sd INT             standard deviation of fragment length (50)\n"
+           "  --sub_rate REAL             substitutions per simulated base (0.0)\n"
+           "  --ins_rate REAL             insertions per simulated base (0.0)\n"
+           "  --del_rate REAL             deletions per simulated base (0.0)\n"
+           "  --n_rate REAL               Ns per simulated base (0.0)\n"
+           "  --seed INT                  random seed for generated data\n"
+           "  --profile                   report hardware counters per kernel stage\n"
+           "                              with --test and --allvsall\n"
+           "  --stats FILENAME            append per-stage latency histograms as JSON\n"
+           "                              at exit and on SIGUSR1\n"
+           "  --hugepages                 transparent huge pages for reads and buffers\n"
+           "  --prefault                  fault in reads and buffers when allocated\n"
+           "\n"
+           "Input files may be given as - to read from standard input.\n"
           );
 }
 
@@ -239,34 +630,191 @@ void init_scoring_matrices (
     }
 }
 
-void cmd_overlap()
+void cmd_list_reads()
 {
   char * head;
   long head_len;
-  char * seq[2];
-  long seq_len[2];
+  char * seq;
+  long seq_len;
   long qno;
   long qsize;
+
+  if (opt_threads > 1)
+  {
+    /* parse chunks of the file in parallel and print them in order */
+    salt_batch_t ** batches = salt_fasta_getbatch_parallel(opt_list_reads,
+                                                           opt_threads);
+    for (long i = 0; i < opt_threads; ++i)
+    {
+      for (long j = 0; j < batches[i]->count; ++j)
+        fprintf(stdout, "%s\n%s\n\n",
+                SALT_BATCH_HEAD(batches[i], j),
+                SALT_BATCH_SEQ(batches[i], j));
+      salt_batch_destroy(batches[i]);
+    }
+    free(batches);
+    return;
+  }
+
+  salt_fasta_t * fd = salt_fasta_open(opt_list_reads);
+  progress_init("Reading fasta file", salt_fasta_getfilesize(fd));
+  while (salt_fasta_getnext(fd, &head, &head_len,
+                            &seq, &seq_len, &qno, &qsize))
+  {
+    fprintf(stdout, "%s\n%s\n\n", head, seq);
+    progress_update(salt_fasta_getfilepos(fd));
+  }
+  progress_done();
+  salt_fasta_close(fd);
+}
+
+void cmd_list_fastq()
+{
+  char * head;
+  long head_len;
+  char * seq;
+  long seq_len;
+  char * qual;
+  long qno;
+
+  salt_fastq_t * fd = salt_fastq_open(opt_list_fastq);
+  salt_fastq_set_phred_offset(fd, opt_fastq_ascii);
+  progress_init("Reading fastq file", salt_fastq_getfilesize(fd));
+
+  while (salt_fastq_getnext(fd, &head, &head_len,
+                            &seq, &seq_len, &qual, &qno))
+  {
+    /* qualities are written back with offset 33 */
+    for (long i = 0; i < seq_len; ++i)
+      qual[i] += 33;
+
+    fprintf(stdout, "@%s\n%s\n+\n%s\n", head, seq, qual);
+    progress_update(salt_fastq_getfilepos(fd));
+  }
+  progress_done();
+  salt_fastq_close(fd);
+}
+
+void cmd_build_store()
+{
+  if (!opt_output)
+    fatal("Option --build-store requires --output");
+
+  salt_store_build(opt_build_store, opt_output,
+                   SALT_STORE_HEADERS | SALT_STORE_SIZES);
+}
+
+void cmd_list_store()
+{
+  salt_store_t * store = salt_store_open(opt_list_store);
+  long count = salt_store_count(store);
+  long alloc = 0;
+  char * seq = NULL;
+
+  for (long i = 0; i < count; ++i)
+  {
+    long len = roundup(salt_store_seqlen(store, i) + 1, SALT_ALIGNMENT_MAX);
+    if (len > alloc)
+    {
+      free(seq);
+      seq = (char *) xmalloc(len, SALT_ALIGNMENT_MAX);
+      alloc = len;
+    }
+
+    salt_store_getseq(store, i, seq, 0);
+    fprintf(stdout, "%s\n%s\n\n", salt_store_header(store, i), seq);
+  }
+
+  free(seq);
+  salt_store_close(store);
+}
+
+void cmd_faidx()
+{
+  long beg = 0;
+  long end = -1;
+  long len;
+  long i;
+
+  if (!opt_region)
+  {
+    salt_fai_build(opt_faidx);
+    return;
+  }
+
+  /* like samtools, (re)build a missing or outdated index first */
+  char * fainame = (char *) xmalloc(strlen(opt_faidx) + 5, 8);
+  struct stat fa_stat, fai_stat;
+
+  sprintf(fainame, "%s.fai", opt_faidx);
+  if (stat(opt_faidx, &fa_stat))
+    fatal("Error: Unable to open fasta file (%s)", opt_faidx);
+  if (stat(fainame, &fai_stat) || fai_stat.st_mtime < fa_stat.st_mtime)
+    salt_fai_build(opt_faidx);
+  free(fainame);
+
+  salt_fai_t * fai = salt_fai_load(opt_faidx);
+
+  if (opt_region[0] == '#')
+  {
+    /* 0-based ordinal number of the record */
+    i = atol(opt_region + 1);
+    if (i < 0 || i >= salt_fai_count(fai))
+      fatal("Record %s not in fasta index", opt_region);
+  }
+  else if ((i = salt_fai_lookup(fai, opt_region)) < 0)
+  {
+    /* name:beg-end with 1-based inclusive coordinates */
+    char * name = xstrdup_aligned(opt_region, 8);
+    char * colon = strrchr(name, ':');
+
+    if (!colon)
+      fatal("Record %s not in fasta index", opt_region);
+
+    *colon = 0;
+    if (sscanf(colon + 1, "%ld-%ld", &beg, &end) < 1)
+      fatal("Illegal region %s", opt_region);
+    beg--;
+
+    if ((i = salt_fai_lookup(fai, name)) < 0)
+      fatal("Record %s not in fasta index", name);
+    free(name);
+  }
+
+  char * seq = salt_fai_fetch(fai, i, beg, end, &len);
+
+  fprintf(stdout, ">%s\n", opt_region[0] == '#' ? salt_fai_name(fai, i)
+                                                 : opt_region);
+  for (long j = 0; j < len; j += 60)
+    fprintf(stdout, "%.60s\n", seq + j);
+
+  salt_fai_close(fai);
+}
+
+void cmd_overlap()
+{
+  char * seq[2];
+  long seq_len[2];
   long scorematrix_long[SCORE_MATRIX_SIZE*SCORE_MATRIX_SIZE] __attribute__((aligned(SALT_ALIGNMENT_MAX)));
   WORD scorematrix_word[SCORE_MATRIX_SIZE*SCORE_MATRIX_SIZE] __attribute__((aligned(SALT_ALIGNMENT_MAX)));
   char scorematrix_char[SCORE_MATRIX_SIZE*SCORE_MATRIX_SIZE] __attribute__((aligned(SALT_ALIGNMENT_MAX)));
   salt_fasta_t * fd;
+  salt_batch_t * batch;
 
   long psmscore = 0, overlaplen = 0, matchcase = 0;
 
   fd = salt_fasta_open(opt_overlap_file);
 
-  /* get first sequence */
-  salt_fasta_getnext(fd, &head, &head_len,
-                     &seq[0], &seq_len[0], &qno, &qsize);
-
-  seq[0] = xstrdup_aligned(seq[0], SALT_ALIGNMENT_MAX);
+  /* get the first two sequences, already aligned and padded */
+  batch = salt_batch_create(2, 0);
 
-  /* get second sequence */
-  salt_fasta_getnext(fd, &head, &head_len,
-                     &seq[1], &seq_len[1], &qno, &qsize);
+  if (salt_fasta_getbatch(fd, batch) < 2)
+    fatal("Error: at least two sequences are required (%s)", opt_overlap_file);
 
-  seq[1] = xstrdup_aligned(seq[1], SALT_ALIGNMENT_MAX);
+  seq[0] = SALT_BATCH_SEQ(batch, 0);
+  seq[1] = SALT_BATCH_SEQ(batch, 1);
+  seq_len[0] = batch->seq_len[0];
+  seq_len[1] = batch->seq_len[1];
 
   /* setup scoring matrix */
   init_scoring_matrices (scorematrix_long, scorematrix_word, scorematrix_char);
@@ -315,145 +863,207 @@ void cmd_overlap()
 
   printf("AVX2 16bit: psmscore: %ld, overlaplen: %ld, matchcase: %ld\n", psmscore, overlaplen, matchcase);
 
+  salt_batch_destroy(batch);
   salt_fasta_close(fd);
 }
 
-/*
-void cmd_run_test ()
+void cmd_allvsall()
 {
-    // get command line options
-    int runs          = opt_runs;
-    int reads_min_len = opt_reads_min_len;
-    int reads_max_len = opt_reads_max_len;
-    int min_overlap   = opt_min_overlap;
-    int verbose       = opt_verbose;
-
-    assert (min_overlap < reads_min_len);
-
-    // user output showing options
-    printf ("Starting with\n");
-    printf ("   algorithm:     %s\n", opt_algorithm);
-    printf ("   runs:          %i\n", runs);
-    printf ("   reads_min_len: %i\n", reads_min_len);
-    printf ("   reads_max_len: %i\n", reads_max_len);
-    printf ("   min_overlap:   %i\n", min_overlap);
-
-    // prepare variables
-    char* seq[2];
-    long  seq_len[2];
-    int overlap;
-    long psmscore = 0, overlaplen = 0, matchcase = 0;
-
-    reads_max_len++; // functions expect min<max, because the interval is [min,max)
-    seq[0] = (char*) xmalloc (reads_max_len * sizeof(char), SALT_ALIGNMENT_MAX);
-    seq[1] = (char*) xmalloc (reads_max_len * sizeof(char), SALT_ALIGNMENT_MAX);
-
-    long scorematrix_long[SCORE_MATRIX_SIZE*SCORE_MATRIX_SIZE] __attribute__((aligned(SALT_ALIGNMENT_MAX)));
-    WORD scorematrix_word[SCORE_MATRIX_SIZE*SCORE_MATRIX_SIZE] __attribute__((aligned(SALT_ALIGNMENT_MAX)));
-    char scorematrix_char[SCORE_MATRIX_SIZE*SCORE_MATRIX_SIZE] __attribute__((aligned(SALT_ALIGNMENT_MAX)));
-
-    init_scoring_matrices (scorematrix_long, scorematrix_word, scorematrix_char);
-
-    // generate two random overlapping sequences
-    seq_len[0] = random_int_range (reads_min_len, reads_max_len);
-    seq_len[1] = random_int_range (reads_min_len, reads_max_len);
-    overlap    = random_int_range (min_overlap,   seq_len[0] + seq_len[1] - min_overlap);
-    generate_pair (seq[0], seq_len[0], seq[1], seq_len[1], overlap);
-    seq[0][seq_len[0]] = '\0';
-    seq[1][seq_len[1]] = '\0';
-
-    // user output the sequences
-    if (verbose) {
-        printf ("=============================================================\n");
-        printf ("dbs: %s len: %ld\n", seq[0], seq_len[0]);
-        printf ("qry: %s len: %ld\n", seq[1], seq_len[1]);
-        printf ("overlap: %u\n\n", overlap);
-    }
+  salt_allvsall_t opts;
+  salt_fasta_t * fd;
+  salt_batch_t * batch;
 
-    // convert sequences to a number representation
-    convert(seq[0]);
-    convert(seq[1]);
-
-    clock_t stime = clock();
-
-    // test-analyze many different random sequences
-    for (int i = 0; i < runs; i++) {
-        // select algorithm and run it
-        if (strcmp(opt_algorithm, "CPU") == 0) {
-            salt_overlap_nuc4(
-                seq[0], seq[0] + seq_len[0],
-                seq[1], seq[1] + seq_len[1],
-                (long *)scorematrix_long,
-                &psmscore,
-                &overlaplen,
-                &matchcase
-            );
-        } else if (strcmp(opt_algorithm, "SSE8") == 0) {
-            salt_overlap_nuc4_sse_8(
-                (BYTE *)seq[0], (BYTE *)seq[0] + seq_len[0],
-                (BYTE *)seq[1], (BYTE *)seq[1] + seq_len[1],
-                scorematrix_char,
-                &psmscore,
-                &overlaplen,
-                &matchcase
-            );
-        } else if (strcmp(opt_algorithm, "SSE16") == 0) {
-            salt_overlap_nuc4_sse_16(
-                (BYTE *)seq[0], (BYTE *)seq[0] + seq_len[0],
-                (BYTE *)seq[1], (BYTE *)seq[1] + seq_len[1],
-                scorematrix_word,
-                &psmscore,
-                &overlaplen,
-                &matchcase
-            );
-        } else if (strcmp(opt_algorithm, "AVX8") == 0) {
-            salt_overlap_nuc4_avx2_8(
-                (BYTE *)seq[0], (BYTE *)seq[0] + seq_len[0],
-                (BYTE *)seq[1], (BYTE *)seq[1] + seq_len[1],
-                scorematrix_char,
-                &psmscore,
-                &overlaplen,
-                &matchcase
-            );
-        } else if (strcmp(opt_algorithm, "AVX16") == 0) {
-            salt_overlap_nuc4_avx2_16(
-                (BYTE *)seq[0], (BYTE *)seq[0] + seq_len[0],
-                (BYTE *)seq[1], (BYTE *)seq[1] + seq_len[1],
-                scorematrix_word,
-                &psmscore,
-                &overlaplen,
-                &matchcase
-            );
-        } else {
-            printf ("Unknown algorithm: '%s'. Aborting.\n", opt_algorithm);
-            exit(0);
-        }
-    }
+  salt_allvsall_init(&opts);
 
-    // user output the results
-    int noverlap;
-    if (matchcase) {
-        noverlap = seq_len[0] + seq_len[1] - overlaplen;
-    } else {
-        noverlap = overlaplen;
-    }
-    if (verbose) {
-        printf ("%s: psmscore: %3ld, overlaplen: %3ld, matchcase: %ld, actual overlap: %3d\n", opt_algorithm, psmscore, overlaplen, matchcase, noverlap);
-    }
+  int format = SALT_FORMAT_PAF;
+  if (opt_format && !strcmp(opt_format, "gfa"))
+    format = SALT_FORMAT_GFA;
+  else if (opt_format && strcmp(opt_format, "paf"))
+    fatal("The argument to --format must be paf or gfa");
+
+  /* the band is scored by the banded routine, not by a kernel */
+  if (opt_minimizers && opt_band >= 0 && opt_algorithm)
+    fatal("--algorithm cannot be used with a band of diagonals "
+          "(--minimizers without --band -1)");
+
+  opts.kernel = salt_kernel_get(opt_algorithm ? opt_algorithm : "CPU");
+  if (!opts.kernel)
+    fatal("Unknown or unsupported algorithm: %s", opt_algorithm);
+
+  opts.min_overlap = opt_min_overlap;
+  opts.min_identity = opt_min_identity;
+
+  /* read all sequences into one batch */
+  fd = salt_fasta_open(opt_allvsall);
+  batch = salt_batch_create(0, 0);
+  salt_fasta_getbatch(fd, batch);
+  salt_fasta_close(fd);
+
+  salt_readset_t * reads = salt_readset_create(batch, opt_both_strands ? 2 : 1);
+
+  salt_writer_t * writer = salt_writer_open(opt_output, format,
+                                            opt_threads, batch);
+
+  opts.report = salt_writer_report;
+  opts.report_data = writer;
+
+  /* only overlap pairs sharing minimizers, around their diagonal */
+  salt_mindex_t * index = NULL;
+  if (opt_minimizers)
+  {
+    index = salt_minimizer_index(reads, opt_kmer_len, opt_window);
+    opts.candidates = salt_minimizer_candidates;
+    opts.candidates_data = index;
+    opts.band = opt_band;
+  }
+
+  if (opt_threads > 1)
+    opts.pool = salt_pool_create(opt_threads);
+
+  long count = salt_allvsall(reads, &opts);
 
-    if (overlap!=noverlap) {
-        printf ("Warning: wrong overlaps %i vs %i! Seed: %i", overlap, noverlap, opt_seed);
+  if (opts.pool)
+    salt_pool_destroy(opts.pool);
+
+  if (opt_profile)
+  {
+    salt_stage_t stage;
+    char title[128];
+
+    salt_stage_total(&stage);
+    snprintf(title, 128, "Profile of all-vs-all with %s (%d threads):",
+             opts.band >= 0 ? "band" : opts.kernel->name, opt_threads);
+    salt_stage_report(stderr, title, &stage);
+  }
+
+  if (index)
+    salt_minimizer_index_destroy(index);
+
+  salt_writer_close(writer);
+
+  fprintf(stderr, "%ld overlaps among %ld reads\n", count, batch->count);
+
+  salt_readset_destroy(reads);
+  salt_batch_destroy(batch);
+}
+
+void cmd_run_test()
+{
+  char range[64];
+  FILE * out = stdout;
+  int json = 0;
+
+  if (opt_format && !strcmp(opt_format, "json"))
+    json = 1;
+  else if (opt_format && strcmp(opt_format, "csv"))
+    fatal("The argument to --format must be csv or json");
+
+  /* without a grid, benchmark the range of read lengths */
+  if (!opt_lengths)
+  {
+    if (opt_reads_min_len == opt_reads_max_len)
+      snprintf(range, 64, "%d", opt_reads_min_len);
+    else
+      snprintf(range, 64, "%d-%d", opt_reads_min_len, opt_reads_max_len);
+    opt_lengths = range;
+  }
+
+  if (opt_output && !(out = fopen(opt_output, "w")))
+    fatal("Unable to open output file for writing (%s)", opt_output);
+
+  bench_run(opt_algorithm, opt_lengths, opt_pairs, opt_runs, opt_warmup,
+            opt_min_overlap, json, opt_profile, out);
+
+  if (out != stdout)
+    fclose(out);
+}
+
+void cmd_conformance()
+{
+  FILE * out = stdout;
+
+  if (opt_output && !(out = fopen(opt_output, "w")))
+    fatal("Unable to open output file for writing (%s)", opt_output);
+
+  long errors = conform_run(opt_algorithm, opt_lengths ? opt_lengths : "1-1000",
+                            opt_pairs, opt_exhaustive, opt_errors, out);
+
+  if (out != stdout)
+    fclose(out);
+
+  if (errors)
+    exit(EXIT_FAILURE);
+}
+
+void cmd_simulate()
+{
+  salt_sim_t sim;
+  FILE * out;
+  FILE * mates = NULL;
+
+  salt_sim_init(&sim);
+
+  sim.genome_len  = opt_genome_len;
+  sim.reads       = opt_reads;
+  sim.min_len     = opt_reads_min_len;
+  sim.max_len     = opt_reads_max_len;
+  sim.paired      = opt_paired;
+  sim.insert_mean = opt_insert_size;
+  sim.insert_sd   = opt_insert_sd;
+  sim.sub_rate    = opt_sub_rate;
+  sim.ins_rate    = opt_ins_rate;
+  sim.del_rate    = opt_del_rate;
+  sim.n_rate      = opt_n_rate;
+  sim.seed        = (uint64_t) opt_seed;
+  sim.threads     = opt_threads;
+
+  if (!opt_format || !strcmp(opt_format, "fasta"))
+    sim.format = SALT_SIM_FASTA;
+  else if (!strcmp(opt_format, "fastq"))
+    sim.format = SALT_SIM_FASTQ;
+  else
+    fatal("The argument to --format must be fasta or fastq");
+
+  if (!(out = fopen(opt_simulate, "w")))
+    fatal("Unable to open output file for writing (%s)", opt_simulate);
+  if (opt_mates && !(mates = fopen(opt_mates, "w")))
+    fatal("Unable to open output file for writing (%s)", opt_mates);
+
+  long t0 = getusec();
+
+  char * genome = salt_sim_genome(&sim);
+
+  if (opt_genome)
+  {
+    FILE * fp = fopen(opt_genome, "w");
+    if (!fp)
+      fatal("Unable to open output file for writing (%s)", opt_genome);
+
+    fprintf(fp, ">genome length=%ld seed=%d\n", sim.genome_len, opt_seed);
+    for (long i = 0; i < sim.genome_len; i += 80)
+    {
+      long n = sim.genome_len - i < 80 ? sim.genome_len - i : 80;
+      fprintf(fp, "%.*s\n", (int)n, genome + i);
     }
 
-    // user output timing information
-    clock_t etime = clock();
-    printf ("\nFinished.\nClock time: %li\n", etime-stime);
+    if (fclose(fp))
+      fatal("Unable to write output file (%s)", opt_genome);
+  }
 
-    // clean up
-    xfree (seq[0]);
-    xfree (seq[1]);
+  long bytes = salt_sim_reads(&sim, genome, out, mates);
+
+  if (fclose(out) || (mates && fclose(mates)))
+    fatal("Unable to write simulated reads");
+
+  long t1 = getusec();
+  double seconds = (t1 - t0) / 1e6;
+
+  fprintf(stdout, "Simulated %ld %s (%ld bytes) in %.3f s (%.1f MB/s)\n",
+          sim.reads, sim.paired ? "pairs" : "reads", bytes, seconds,
+          seconds > 0 ? bytes / seconds / 1e6 : 0);
+
+  free(genome);
 }
-*/
 
 void getentirecommandline(int argc, char ** argv)
 {
@@ -478,30 +1088,36 @@ void fillheader()
            PROG_NAME, PROG_VERSION, PROG_ARCH);
 }
 
+/* on stderr, as several commands write their data to stdout */
 void show_header()
 {
-  fprintf(stdout, "                 ____ \n"
+  fprintf(stderr, "                 ____ \n"
                   "     _________ _/ / /_\n"
                   "    / ___/ __ `/ / __/\n"
                   "   (__  ) /_/ / / /_ \n"
                   "  /____/\\__,_/_/\\__/ \n");
-  fprintf (stdout, "%s\n\n", progheader);
+  fprintf(stderr, "%s\n\n", progheader);
 }
 
 int main (int argc, char * argv[])
 {
-  char * head;
-  long head_len;
-  char * seq;
-  long seq_len;
-  long qno;
-  long qsize;
-
   fillheader();
   getentirecommandline(argc, argv);
 
   args_init(argc, argv);
-  srand(opt_seed);
+  random_seed(opt_seed);
+  salt_arena_defaults((opt_hugepages ? SALT_ARENA_HUGEPAGES : 0) |
+                      (opt_prefault ? SALT_ARENA_PREFAULT : 0));
+
+  if (opt_profile)
+    salt_stage_enable(SALT_STAGE_PERF);
+
+  if (opt_stats)
+  {
+    if (!opt_profile)
+      salt_stage_enable(SALT_STAGE_CYCLES);
+    salt_stage_watch(opt_stats);
+  }
 
   show_header();
 
@@ -511,20 +1127,50 @@ int main (int argc, char * argv[])
   }
   else if (opt_list_reads)
   {
-    salt_fasta_t * fd = salt_fasta_open(opt_list_reads);
-    while (salt_fasta_getnext(fd, &head, &head_len,
-                              &seq, &seq_len, &qno, &qsize))
-    {
-      fprintf(stdout, "%s\n%s\n\n", head, seq);
-    }
-    salt_fasta_close(fd);
+    cmd_list_reads();
+  }
+  else if (opt_list_fastq)
+  {
+    cmd_list_fastq();
+  }
+  else if (opt_faidx)
+  {
+    cmd_faidx();
+  }
+  else if (opt_build_store)
+  {
+    cmd_build_store();
+  }
+  else if (opt_list_store)
+  {
+    cmd_list_store();
   }
   else if (opt_overlap_file)
   {
     cmd_overlap();
-  } /*else if (opt_run_test) {
-      cmd_run_test();
-  }*/
+  }
+  else if (opt_allvsall)
+  {
+    cmd_allvsall();
+  }
+  else if (opt_run_test)
+  {
+    cmd_run_test();
+  }
+  else if (opt_conformance)
+  {
+    cmd_conformance();
+  }
+  else if (opt_simulate)
+  {
+    cmd_simulate();
+  }
+
+  if (opt_stats)
+    salt_stage_dump("exit");
+
+  if (opt_profile)
+    show_rusage();
 
   return (EXIT_SUCCESS);
 }
@@ -0,0 +1,35 @@
+/*
+    Copyright (C) 2014 Tomas Flouri & Lucas Czech
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Contact: Tomas Flouri <Tomas.Flouri@h-its.org>,
+    Exelixis Lab, Heidelberg Instutute for Theoretical Studies
+    Schloss-Wolfsbrunnenweg 35, D-69118 Heidelberg, Germany
+*/
+
+#define BENCH_MAX_KERNELS 64
+
+/* functions in bench.c */
+
+long bench_kernels(const char * algorithms, const salt_kernel_t ** kernels);
+
+void bench_run(const char * algorithms, const char * lengths, long pairs,
+               long trials, long warmup, long min_overlap, int json,
+               int profile, FILE * out);
+
+/* functions in conform.c */
+
+long conform_run(const char * algorithms, const char * lengths, long pairs,
+                 long exhaustive, double errors, FILE * out);